@@ -1,12 +1,22 @@
 #include "ICP101xx.h"
-#include <math.h>
+#include "altitude.h"
+#include <stdlib.h>
 
 
 #define NULL_CHECK_PARAM(ICPPress_Def)  if ((NULL == ICPPress_Def) || (NULL == ICPPress_Def->commHandle) || (NULL == ICPPress_Def->delayHandle)) { return ICP_NULL_PARAM; }
 
-static void calculate_conversion_constants(float *p_Pa, float *p_LUT, float *out);
+#define ICP_LUT_LOWER           3670016     /* 3.5 * 2^20 */
+#define ICP_LUT_UPPER           12058624    /* 11.5 * 2^20 */
+#define ICP_OFFSET_FACTOR       2048
+#define ICP_QUADR_SHIFT         24          /* Quadratic factor 1 / 2^24 */
+#define ICP_PA_CALIB_STEP       5000        /* The calibration points 45000, 80000 and 105000 Pa are 9, 16 and 21 steps */
+#define ICP_PA_CALIB_0          9
+#define ICP_PA_CALIB_1          16
+#define ICP_PA_CALIB_2          21
+#define ICP_PRESSURE_FRAC_BITS  8
 
-static uint8_t gUpdateCheck_u8 = 0;
+static ICPPress_State_t calculate_conversion_constants(ICPPRess_Def_t *locICPPress_p, uint16_t locRawTemperature_u16);
+static int64_t div_round(int64_t numerator, int64_t denominator);
 
 
 ICPPress_State_t ICPPress_Init(ICPPRess_Def_t *locICPPress_p)
@@ -15,7 +25,7 @@ ICPPress_State_t ICPPress_Init(ICPPRess_Def_t *locICPPress_p)
     uint8_t locOTP_au8[5];
     uint8_t locWriteData_au8[2];
     uint8_t locReadData_au8[3];
-    uint16_t locOut_u16;
+    uint16_t locConstants_au16[4];
 
     NULL_CHECK_PARAM(locICPPress_p);
 
@@ -50,34 +60,49 @@ ICPPress_State_t ICPPress_Init(ICPPRess_Def_t *locICPPress_p)
 
         locICPPress_p->delayHandle(1);
         
-        locOut_u16 = (locReadData_au8[0] << 8) | locReadData_au8[1];
-        locICPPress_p->sensorConstants[i] = (float)locOut_u16;
+        locConstants_au16[i] = (locReadData_au8[0] << 8) | locReadData_au8[1];
     }
     /* Read OTP ends */
 
-    locICPPress_p->pPaCalib[0] = 45000.0;
-    locICPPress_p->pPaCalib[1] = 80000.0;
-    locICPPress_p->pPaCalib[2] = 105000.0;
-    locICPPress_p->LUT_lower = 3.5 * (1 << 20);
-    locICPPress_p->LUT_upper = 11.5 * (1 << 20);
-    locICPPress_p->quadrFactor = 1.0 / 16777216.0;
-    locICPPress_p->offsetFactor = 2048.0;
+    return ICPPress_LoadCalibration(locICPPress_p, locConstants_au16);
+}
+
+
+ICPPress_State_t ICPPress_LoadCalibration(ICPPRess_Def_t *locICPPress_p, uint16_t const *locConstants_pu16)
+{
+    if ((NULL == locICPPress_p) || (NULL == locConstants_pu16))
+    {
+        return ICP_NULL_PARAM;
+    }
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        locICPPress_p->sensorConstants[i] = locConstants_pu16[i];
+    }
 
-    gUpdateCheck_u8 = 1;
+    /* The OTP dependent terms do not change until the next reset */
+    locICPPress_p->lutOffset[0] = ICP_LUT_LOWER;
+    locICPPress_p->lutOffset[1] = ICP_OFFSET_FACTOR * (int32_t)locICPPress_p->sensorConstants[3];
+    locICPPress_p->lutOffset[2] = ICP_LUT_UPPER;
+    locICPPress_p->conversion.valid = 0;
+    locICPPress_p->calibrated = 1;
 
     return ICP_OK;
 }
 
 
-void ICPPress_SoftReset(ICPPRess_Def_t *locICPPress_p)
+ICPPress_State_t ICPPress_SoftReset(ICPPRess_Def_t *locICPPress_p)
 {
     uint8_t locWriteData_au8[2] = {0x80, 0x5D};
 
     NULL_CHECK_PARAM(locICPPress_p);
 
-    locICPPress_p->commHandle(I2C_EVENT_TRANSMIT, ICP_I2C_ADDRESS, locWriteData_au8, 2, NULL);
+    if (ICP_OK != locICPPress_p->commHandle(I2C_EVENT_TRANSMIT, ICP_I2C_ADDRESS, locWriteData_au8, 2, NULL))
+    {
+        return ICP_COMM_ERROR;
+    }
 
-    gUpdateCheck_u8 = 0;
+    return ICP_OK;
 }
 
 
@@ -104,12 +129,14 @@ ICPPress_State_t ICPPress_ReadID(ICPPRess_Def_t *locICPPress_p, uint16_t *locDev
 }
 
 
-ICPPress_State_t ICPPress_SetMeasurementMode(ICPPRess_Def_t *locICPPress_p, uint16_t locModeCmd_u16)
+ICPPress_State_t ICPPress_SelectMeasurementMode(ICPPRess_Def_t *locICPPress_p, uint16_t locModeCmd_u16)
 {
-    ICPPress_State_t locRet = ICP_OK;
-    uint8_t locWriteData_au8[2];
+    ICPPress_State_t locRet;
 
-    NULL_CHECK_PARAM(locICPPress_p);
+    if (NULL == locICPPress_p)
+    {
+        return ICP_NULL_PARAM;
+    }
 
     if ((ICP_CMD_MEASURE_LP_T_FIRST == locModeCmd_u16) || (ICP_CMD_MEASURE_N_T_FIRST == locModeCmd_u16) || (ICP_CMD_MEASURE_LN_T_FIRST == locModeCmd_u16) || (ICP_CMD_MEASURE_ULN_T_FIRST == locModeCmd_u16))
     {
@@ -121,16 +148,30 @@ ICPPress_State_t ICPPress_SetMeasurementMode(ICPPRess_Def_t *locICPPress_p, uint
     }
     else 
     {
-        locRet = ICP_INVALID_MODE;
-        return locRet;
+        return ICP_INVALID_MODE;
     }
 
     locICPPress_p->sensorMeasurementMode = locModeCmd_u16;
     locICPPress_p->sensorDataOutMode = locRet;
-    locWriteData_au8[0] = locICPPress_p->sensorMeasurementMode >> 8;
-    locWriteData_au8[1] = locICPPress_p->sensorMeasurementMode;
 
-    if (ICP_OK != locICPPress_p->commHandle(I2C_EVENT_TRANSMIT, ICP_I2C_ADDRESS, locWriteData_au8, 2, NULL))
+    return locRet;
+}
+
+
+ICPPress_State_t ICPPress_SetMeasurementMode(ICPPRess_Def_t *locICPPress_p, uint16_t locModeCmd_u16)
+{
+    ICPPress_State_t locRet;
+
+    NULL_CHECK_PARAM(locICPPress_p);
+
+    locRet = ICPPress_SelectMeasurementMode(locICPPress_p, locModeCmd_u16);
+
+    if (ICP_INVALID_MODE == locRet)
+    {
+        return locRet;
+    }
+
+    if (ICP_OK != ICPPress_StartConversion(locICPPress_p))
     {
         locRet = ICP_COMM_ERROR;
     }
@@ -139,17 +180,34 @@ ICPPress_State_t ICPPress_SetMeasurementMode(ICPPRess_Def_t *locICPPress_p, uint
 }
 
 
-ICPPress_State_t ICPPress_ReadRawData(ICPPRess_Def_t *locICPPress_p, int16_t *locRawTemperature_p16, uint32_t *locRawPressure_p32)
+uint32_t ICPPress_GetConversionTime(uint16_t locModeCmd_u16)
+{
+    switch (locModeCmd_u16)
+    {
+        case ICP_CMD_MEASURE_LP_T_FIRST:
+        case ICP_CMD_MEASURE_LP_P_FIRST:
+            return ICP_CONVERSION_TIME_LP_US;
+
+        case ICP_CMD_MEASURE_N_T_FIRST:
+        case ICP_CMD_MEASURE_N_P_FIRST:
+            return ICP_CONVERSION_TIME_N_US;
+
+        case ICP_CMD_MEASURE_LN_T_FIRST:
+        case ICP_CMD_MEASURE_LN_P_FIRST:
+            return ICP_CONVERSION_TIME_LN_US;
+
+        case ICP_CMD_MEASURE_ULN_T_FIRST:
+        case ICP_CMD_MEASURE_ULN_P_FIRST:
+            return ICP_CONVERSION_TIME_ULN_US;
+
+        default:
+            return 0;
+    }
+}
+
+
+ICPPress_State_t ICPPress_StartConversion(ICPPRess_Def_t *locICPPress_p)
 {
-    /* Temperature data is transmitted in two 8-bit words and pressure data is transmitted in four 8-bit words. 
-     * Regarding the pressure data, only the first three words MMSB, MLSB and LMSB contain information about the 
-     * ADC pressure value p_dout. Therefore, for retrieving the ADC pressure value, LLSB must be disregarded
-     * p_dout = MMSB  16 | MLSB  8| LMSB.
-     * Two bytes of data are always followed by one byte CRC checksum.
-     */
-    uint8_t locADCData_au8[9];
-    uint8_t locTemperatureIndex_u8;
-    uint8_t locPressureIndex_u8;
     uint8_t locWriteData_au8[2];
 
     NULL_CHECK_PARAM(locICPPress_p);
@@ -162,13 +220,64 @@ ICPPress_State_t ICPPress_ReadRawData(ICPPRess_Def_t *locICPPress_p, int16_t *lo
         return ICP_COMM_ERROR;
     }
 
-    locICPPress_p->delayHandle(6);
+    return ICP_OK;
+}
+
+
+ICPPress_State_t ICPPress_FetchRawData(ICPPRess_Def_t *locICPPress_p, int16_t *locRawTemperature_p16, uint32_t *locRawPressure_p32)
+{
+    uint8_t locADCData_au8[ICP_ADC_DATA_SIZE];
+
+    NULL_CHECK_PARAM(locICPPress_p);
+
+    if (ICP_OK != locICPPress_p->commHandle(I2C_EVENT_RECEIVE, ICP_I2C_ADDRESS, locADCData_au8, ICP_ADC_DATA_SIZE, NULL))
+    {
+        return ICP_COMM_ERROR;
+    }
+
+    return ICPPress_DecodeRawData(locICPPress_p, locADCData_au8, locRawTemperature_p16, locRawPressure_p32);
+}
+
+
+ICPPress_State_t ICPPress_ReadRawData(ICPPRess_Def_t *locICPPress_p, int16_t *locRawTemperature_p16, uint32_t *locRawPressure_p32)
+{
+    uint32_t locConversionTime_u32;
+
+    NULL_CHECK_PARAM(locICPPress_p);
+
+    locConversionTime_u32 = ICPPress_GetConversionTime(locICPPress_p->sensorMeasurementMode);
 
-    if (ICP_OK != locICPPress_p->commHandle(I2C_EVENT_RECEIVE, ICP_I2C_ADDRESS, locADCData_au8, 9, NULL))
+    if (0 == locConversionTime_u32)
+    {
+        return ICP_INVALID_MODE;
+    }
+
+    if (ICP_OK != ICPPress_StartConversion(locICPPress_p))
     {
         return ICP_COMM_ERROR;
     }
 
+    /* delayHandle counts in milliseconds, round up so the conversion is always complete */
+    locICPPress_p->delayHandle((locConversionTime_u32 + 999) / 1000);
+
+    return ICPPress_FetchRawData(locICPPress_p, locRawTemperature_p16, locRawPressure_p32);
+}
+
+
+ICPPress_State_t ICPPress_DecodeRawData(ICPPRess_Def_t *locICPPress_p, uint8_t const *locADCData_pu8, int16_t *locRawTemperature_p16, uint32_t *locRawPressure_p32)
+{
+    /* Temperature data is transmitted in two 8-bit words and pressure data is transmitted in four 8-bit words. 
+     * Regarding the pressure data, only the first three words MMSB, MLSB and LMSB contain information about the 
+     * ADC pressure value p_dout. Therefore, for retrieving the ADC pressure value, LLSB must be disregarded
+     * p_dout = MMSB  16 | MLSB  8| LMSB.
+     * Two bytes of data are always followed by one byte CRC checksum.
+     */
+
+    uint8_t locTemperatureIndex_u8;
+    uint8_t locPressureIndex_u8;
+
+    NULL_CHECK_PARAM(locICPPress_p);
+
     if (ICP_TEMPERATURE_FIRST == locICPPress_p->sensorDataOutMode)
     {
         locTemperatureIndex_u8 = 0;
@@ -184,8 +293,8 @@ ICPPress_State_t ICPPress_ReadRawData(ICPPRess_Def_t *locICPPress_p, int16_t *lo
         return ICP_INVALID_MODE;
     }
 
-    *locRawTemperature_p16 = (locADCData_au8[locTemperatureIndex_u8] << 8) | locADCData_au8[locTemperatureIndex_u8 + 1];
-    *locRawPressure_p32 = (locADCData_au8[locPressureIndex_u8] << 16) | (locADCData_au8[locPressureIndex_u8 + 1] << 8) | locADCData_au8[locPressureIndex_u8 + 3];
+    *locRawTemperature_p16 = (locADCData_pu8[locTemperatureIndex_u8] << 8) | locADCData_pu8[locTemperatureIndex_u8 + 1];
+    *locRawPressure_p32 = (locADCData_pu8[locPressureIndex_u8] << 16) | (locADCData_pu8[locPressureIndex_u8 + 1] << 8) | locADCData_pu8[locPressureIndex_u8 + 3];
 
     return ICP_OK;
 }
@@ -196,19 +305,18 @@ ICPPress_State_t ICPPress_GetProcessedData(ICPPRess_Def_t *locICPPress_p, float
     int16_t locTemperature_i16;
     uint32_t locPressure_u32;
 
-    float t;
-    float s1, s2, s3;
-    float res;
-    float in[3];
-    float out[3];
-
     ICPPress_State_t locRet;
 
     NULL_CHECK_PARAM(locICPPress_p);
 
-    if (0 == gUpdateCheck_u8)
+    if (0 == locICPPress_p->calibrated)
     {
-        ICPPress_Init(locICPPress_p);
+        locRet = ICPPress_Init(locICPPress_p);
+
+        if (ICP_OK != locRet)
+        {
+            return locRet;
+        }
     }
 
     locRet = ICPPress_ReadRawData(locICPPress_p, &locTemperature_i16, &locPressure_u32);
@@ -218,44 +326,135 @@ ICPPress_State_t ICPPress_GetProcessedData(ICPPRess_Def_t *locICPPress_p, float
         return locRet;
     }
 
-    t = (float)(locTemperature_i16 - 32768);
-    s1 = locICPPress_p->LUT_lower + (float)(locICPPress_p->sensorConstants[0] * t * t) * locICPPress_p->quadrFactor;
-    s2 = (locICPPress_p->offsetFactor * locICPPress_p->sensorConstants[3]) + (float)(locICPPress_p->sensorConstants[1] * t * t) * locICPPress_p->quadrFactor;
-    s3 = locICPPress_p->LUT_upper + (float)(locICPPress_p->sensorConstants[2] * t * t) * locICPPress_p->quadrFactor;
-    
-    in[0] = s1;
-    in[1] = s2;
-    in[2] = s3;
+    return ICPPress_ProcessRawData(locICPPress_p, locTemperature_i16, locPressure_u32, locTemperature_pf, locPressure_pf, locAltitude_pf);
+}
+
+
+ICPPress_State_t ICPPress_ProcessRawData(ICPPRess_Def_t *locICPPress_p, int16_t locRawTemperature_i16, uint32_t locRawPressure_u32, float *locTemperature_pf, float *locPressure_pf, float *locAltitude_pf)
+{
+    ICPPress_State_t locRet;
+    int32_t locTemperature_i32;
+    uint32_t locPressure_u32;
+
+    locRet = ICPPress_ProcessRawDataFixed(locICPPress_p, locRawTemperature_i16, locRawPressure_u32, &locTemperature_i32, &locPressure_u32);
 
-    calculate_conversion_constants(locICPPress_p->pPaCalib, in, out);
+    if (ICP_OK != locRet)
+    {
+        return locRet;
+    }
 
-    *locTemperature_pf = -45.0 + 175.0 / 65536.0 * (float)locTemperature_i16;
+    *locTemperature_pf = (float)locTemperature_i32 / 100.0f;
 
-    *locPressure_pf = (out[0] + out[1] / (out[2] + (float)locPressure_u32)) / 100.0;
+    *locPressure_pf = (float)locPressure_u32 / 10000.0f;
 
-    res = *locPressure_pf / 1013.96;
-    res = pow(res, 0.19022);
-    res = 1.0 - res;
-    *locAltitude_pf = res * ((*locTemperature_pf + 273.15) / 0.0065);
+    *locAltitude_pf = altitude_get(*locPressure_pf, *locTemperature_pf);
 
-    locRet = ICP_OK;
-    return locRet;
+    return ICP_OK;
+}
+
+
+ICPPress_State_t ICPPress_ProcessRawDataFixed(ICPPRess_Def_t *locICPPress_p, int16_t locRawTemperature_i16, uint32_t locRawPressure_u32, int32_t *locTemperature_pi32, uint32_t *locPressure_pu32)
+{
+    /* T_dout is an unsigned word, the driver passes it around as int16_t */
+    uint16_t locRawTemperature_u16 = (uint16_t)locRawTemperature_i16;
+    ICPPress_Conversion_t *locConv_p;
+    int64_t locDenominator_i64;
+    int64_t locPressure_i64;
+    ICPPress_State_t locRet;
+
+    NULL_CHECK_PARAM(locICPPress_p);
+
+    locConv_p = &locICPPress_p->conversion;
+
+    if ((0 == locConv_p->valid) ||
+        (abs((int32_t)locRawTemperature_u16 - (int32_t)locConv_p->rawTemperature) > ICP_TEMPERATURE_CACHE_BAND))
+    {
+        locRet = calculate_conversion_constants(locICPPress_p, locRawTemperature_u16);
+
+        if (ICP_OK != locRet)
+        {
+            return locRet;
+        }
+    }
+
+    locDenominator_i64 = locConv_p->C + (int64_t)locRawPressure_u32;
+
+    if (0 == locDenominator_i64)
+    {
+        return ICP_UNKNOWN_ERROR;
+    }
+
+    locPressure_i64 = locConv_p->A + div_round(locConv_p->B, locDenominator_i64);
+
+    if ((locPressure_i64 < 0) || (locPressure_i64 > ((int64_t)UINT32_MAX << ICP_PRESSURE_FRAC_BITS) / 100))
+    {
+        return ICP_UNKNOWN_ERROR;
+    }
+
+    *locPressure_pu32 = (uint32_t)((locPressure_i64 * 100 + (1 << (ICP_PRESSURE_FRAC_BITS - 1))) >> ICP_PRESSURE_FRAC_BITS);
+
+    /* T = -45 + 175 * T_dout / 2^16 */
+    *locTemperature_pi32 = -4500 + (int32_t)((17500u * locRawTemperature_u16 + 32768u) >> 16);
+
+    return ICP_OK;
 }
 
 
-static void calculate_conversion_constants(float *p_Pa, float *p_LUT, float *out)
+/**
+ * @brief Fit p = A + B / (C + p_dout) through the three calibration points at one temperature.
+ *
+ * @details The LUT points stay below 2^28, so every product fits in 64 bits. The calibration
+ *          pressures are factored into ICP_PA_CALIB_STEP, which leaves small integer weights.
+ *
+ */
+static ICPPress_State_t calculate_conversion_constants(ICPPRess_Def_t *locICPPress_p, uint16_t locRawTemperature_u16)
 {
-    float A, B, C;
+    ICPPress_Conversion_t *locConv_p = &locICPPress_p->conversion;
+    int32_t t = (int32_t)locRawTemperature_u16 - 32768;
+    int64_t t2 = (int64_t)t * t;
+    int64_t s[3];
+    int64_t locNumerator_i64;
+    int64_t locDenominator_i64;
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        s[i] = locICPPress_p->lutOffset[i] + div_round((int64_t)locICPPress_p->sensorConstants[i] * t2, (int64_t)1 << ICP_QUADR_SHIFT);
+    }
+
+    locNumerator_i64 = s[0] * s[1] * (ICP_PA_CALIB_0 - ICP_PA_CALIB_1) +
+                       s[1] * s[2] * (ICP_PA_CALIB_1 - ICP_PA_CALIB_2) +
+                       s[2] * s[0] * (ICP_PA_CALIB_2 - ICP_PA_CALIB_0);
+    locDenominator_i64 = s[2] * (ICP_PA_CALIB_0 - ICP_PA_CALIB_1) +
+                         s[0] * (ICP_PA_CALIB_1 - ICP_PA_CALIB_2) +
+                         s[1] * (ICP_PA_CALIB_2 - ICP_PA_CALIB_0);
+
+    if ((0 == locDenominator_i64) || (s[0] == s[1]))
+    {
+        return ICP_UNKNOWN_ERROR;
+    }
+
+    locConv_p->C = div_round(locNumerator_i64, locDenominator_i64);
+
+    locConv_p->A = div_round((int64_t)ICP_PA_CALIB_STEP * (1 << ICP_PRESSURE_FRAC_BITS) *
+                             (ICP_PA_CALIB_0 * s[0] - ICP_PA_CALIB_1 * s[1] - (ICP_PA_CALIB_1 - ICP_PA_CALIB_0) * locConv_p->C),
+                             s[0] - s[1]);
+
+    locConv_p->B = ((int64_t)ICP_PA_CALIB_STEP * ICP_PA_CALIB_0 * (1 << ICP_PRESSURE_FRAC_BITS) - locConv_p->A) * (s[0] + locConv_p->C);
+
+    locConv_p->rawTemperature = locRawTemperature_u16;
+    locConv_p->valid = 1;
 
-    C = (p_LUT[0] * p_LUT[1] * (p_Pa[0] - p_Pa[1]) + p_LUT[1] * p_LUT[2] * (p_Pa[1] - p_Pa[2]) + p_LUT[2] * p_LUT[0] * (p_Pa[2] - p_Pa[0])) /
-        (p_LUT[2] * (p_Pa[0] - p_Pa[1]) + p_LUT[0] * (p_Pa[1] - p_Pa[2]) + p_LUT[1] * (p_Pa[2] - p_Pa[0]));
+    return ICP_OK;
+}
 
-    A = (p_Pa[0] * p_LUT[0] - p_Pa[1] * p_LUT[1] - (p_Pa[1] - p_Pa[0]) * C) / (p_LUT[0] - p_LUT[1]);
 
-    B = (p_Pa[0] - A) * (p_LUT[0] + C);
+static int64_t div_round(int64_t numerator, int64_t denominator)
+{
+    if ((numerator < 0) != (denominator < 0))
+    {
+        return (numerator - denominator / 2) / denominator;
+    }
 
-    out[0] = A;
-    out[1] = B;
-    out[2] = C;
+    return (numerator + denominator / 2) / denominator;
 }
 
@@ -11,6 +11,15 @@ extern "C" {
 
 #define ICP_I2C_ADDRESS     0x63
 
+#define ICP_ADC_DATA_SIZE   9
+
+/* The pressure conversion constants depend on temperature only. They are kept while the raw
+ * temperature stays within this many LSB of the one they were computed for. Every LSB of band
+ * can cost up to about 0.5 Pa, 0 recomputes them whenever the raw temperature changes. */
+#ifndef ICP_TEMPERATURE_CACHE_BAND
+#define ICP_TEMPERATURE_CACHE_BAND  0
+#endif
+
 
 #define ICP_CMD_SOFT_RESET  0x805D
 #define ICP_CMD_READ_ID     0xEFC8
@@ -40,6 +49,23 @@ Each measurement command triggers both a temperature and a pressure measurement.
 #define ICP_CMD_MEASURE_LN_P_FIRST  0x5059
 #define ICP_CMD_MEASURE_ULN_P_FIRST 0x58E0
 
+/*
+The conversion time depends on the operation mode only, the data can be read once it has elapsed.
+
+|-----------------------------------------------|
+| OPERATION MODE        | MAX CONVERSION TIME   |
+|-----------------------------------------------|
+| Low Power (LP)        | 1.8 ms                |
+| Normal (N)            | 6.3 ms                |
+| Low Noise (LN)        | 23.8 ms               |
+| Ultra-Low Noise (ULN) | 94.5 ms               |
+|-----------------------------------------------|
+*/
+#define ICP_CONVERSION_TIME_LP_US   1800
+#define ICP_CONVERSION_TIME_N_US    6300
+#define ICP_CONVERSION_TIME_LN_US   23800
+#define ICP_CONVERSION_TIME_ULN_US  94500
+
 
 typedef enum
 {
@@ -89,16 +115,27 @@ typedef ICPPress_State_t (*ICPPress_Com_Handle_t)(ICPPress_Event_t, uint16_t, ui
 typedef uint8_t (*ICPPress_Delay_Handle_t)(uint32_t);
 
 
+/**
+ * Pressure conversion constants for one temperature, p = A + B / (C + p_dout).
+ */
+typedef struct
+{
+  int64_t                 A;                    /* 1/256 Pa */
+  int64_t                 B;                    /* 1/256 Pa */
+  int64_t                 C;
+  uint16_t                rawTemperature;       /* Raw temperature the constants were computed for */
+  uint8_t                 valid;
+} ICPPress_Conversion_t;
+
+
 typedef struct
 {
   uint16_t                sensorMeasurementMode;
   uint8_t                 sensorDataOutMode;
-  float                   sensorConstants[4];
-  float                   pPaCalib[3];
-  float                   LUT_lower;
-  float                   LUT_upper;
-  double                  quadrFactor;
-  float                   offsetFactor;
+  uint16_t                sensorConstants[4];   /* OTP calibration words */
+  uint8_t                 calibrated;           /* sensorConstants and lutOffset are loaded */
+  int32_t                 lutOffset[3];         /* Temperature independent part of the three LUT points */
+  ICPPress_Conversion_t   conversion;
   ICPPress_Com_Handle_t   commHandle;
   ICPPress_Delay_Handle_t delayHandle;
 } ICPPRess_Def_t;
@@ -117,15 +154,30 @@ typedef struct
 ICPPress_State_t ICPPress_Init(ICPPRess_Def_t *locICPPress_p);
 
 
+/**
+ * @brief Function loads calibration data saved from an earlier ICPPress_Init(), instead of reading the OTP sensor.
+ *
+ * @param[in] locICPPress_p         Object where initialization data and data from OTP sensor to be stored
+ * @param[in] locConstants_pu16     The four sensorConstants words of the same sensor
+ *
+ * @retval ICP_OK If the data was loaded successfully. Otherwise, an error code is returned.
+ *
+ */
+ICPPress_State_t ICPPress_LoadCalibration(ICPPRess_Def_t *locICPPress_p, uint16_t const *locConstants_pu16);
+
+
 /**
  * @brief Function sends a command to perform a SW Reset of the device.
  *
  * @param[in] locICPPress_p     Object where initialization data and data from OTP sensor to be stored
  *
+ * @retval ICP_OK If the command was sent successfully. Otherwise, an error code is returned.
+ *
  * @note This command triggers the sensor to reset all internal state machines and reload calibration data from the memory.
+ *       The calibration data read by the driver stays valid, OTP content does not change.
  *
  */
-void ICPPress_SoftReset(ICPPRess_Def_t *locICPPress_p);
+ICPPress_State_t ICPPress_SoftReset(ICPPRess_Def_t *locICPPress_p);
 
 
 /**
@@ -152,6 +204,55 @@ ICPPress_State_t ICPPress_ReadID(ICPPRess_Def_t *locICPPress_p, uint16_t *locDev
 ICPPress_State_t ICPPress_SetMeasurementMode(ICPPRess_Def_t *locICPPress_p, uint16_t locModeCmd_u16);
 
 
+/**
+ * @brief Select a measurement mode and data reading order without any bus access
+ *
+ * @param[in] locICPPress_p     Object where initialization data and data from OTP sensor to be stored
+ * @param[in] locModeCmd_u16    Measuring mode to be used by the next ICPPress_StartConversion()
+ *
+ * @retval ICP_TEMPERATURE_FIRST or ICP_PRESSURE_FIRST if the mode is valid, ICP_INVALID_MODE otherwise.
+ *
+ */
+ICPPress_State_t ICPPress_SelectMeasurementMode(ICPPRess_Def_t *locICPPress_p, uint16_t locModeCmd_u16);
+
+
+/**
+ * @brief Get the maximum conversion time of a measurement mode
+ *
+ * @param[in] locModeCmd_u16    Measuring mode
+ *
+ * @retval Conversion time in microseconds, 0 if the mode is invalid.
+ *
+ */
+uint32_t ICPPress_GetConversionTime(uint16_t locModeCmd_u16);
+
+
+/**
+ * @brief Send the measurement command of the selected mode, the sensor starts converting
+ *
+ * @param[in] locICPPress_p     Object where initialization data and data from OTP sensor to be stored
+ *
+ * @retval ICP_OK If the command was sent successfully. Otherwise, an error code is returned.
+ *
+ * @note The result can be fetched ICPPress_GetConversionTime() later.
+ *
+ */
+ICPPress_State_t ICPPress_StartConversion(ICPPRess_Def_t *locICPPress_p);
+
+
+/**
+ * @brief Read the result of a conversion started by ICPPress_StartConversion()
+ *
+ * @param[in] locICPPress_p           Object where initialization data and data from OTP sensor be stored
+ * @param[out] locRawTemperature_p16  Pointer to memory where Temperature ADC to be stored
+ * @param[out] locRawPressure_p32     Pointer to memory where Pressure ADC to be stored
+ *
+ * @retval ICP_OK If the data was read successfully. Otherwise, an error code is returned.
+ *
+ */
+ICPPress_State_t ICPPress_FetchRawData(ICPPRess_Def_t *locICPPress_p, int16_t *locRawTemperature_p16, uint32_t *locRawPressure_p32);
+
+
 /**
  * @brief Read Raw ADC data including 16-bit temperature and 24-bit pressure
  *
@@ -161,10 +262,26 @@ ICPPress_State_t ICPPress_SetMeasurementMode(ICPPRess_Def_t *locICPPress_p, uint
  *
  * @retval ICP_OK If the notification was sent successfully. Otherwise, an error code is returned.
  *
+ * @note Blocks in delayHandle for the conversion time of the selected mode.
+ *
  */
 ICPPress_State_t ICPPress_ReadRawData(ICPPRess_Def_t *locICPPress_p, int16_t *locRawTemperature_p16, uint32_t *locRawPressure_p32);
 
 
+/**
+ * @brief Decode a measurement result that was read from the sensor outside of the driver
+ *
+ * @param[in] locICPPress_p           Object where initialization data and data from OTP sensor be stored
+ * @param[in] locADCData_pu8          Buffer of ICP_ADC_DATA_SIZE bytes as returned by the sensor
+ * @param[out] locRawTemperature_p16  Pointer to memory where Temperature ADC to be stored
+ * @param[out] locRawPressure_p32     Pointer to memory where Pressure ADC to be stored
+ *
+ * @retval ICP_OK If the data was decoded successfully. Otherwise, an error code is returned.
+ *
+ */
+ICPPress_State_t ICPPress_DecodeRawData(ICPPRess_Def_t *locICPPress_p, uint8_t const *locADCData_pu8, int16_t *locRawTemperature_p16, uint32_t *locRawPressure_p32);
+
+
 /**
  * @brief Read Raw ADC data then calculate these values to standard units.
  *
@@ -177,6 +294,40 @@ ICPPress_State_t ICPPress_ReadRawData(ICPPRess_Def_t *locICPPress_p, int16_t *lo
  *
  */
 ICPPress_State_t ICPPress_GetProcessedData(ICPPRess_Def_t *locICPPress_p, float *locTemperature_pf, float *locPressure_pf, float *locAltitude_pf);
+
+
+/**
+ * @brief Convert raw ADC values to standard units without any bus access.
+ *
+ * @param[in] locICPPress_p           Object where initialization data and data from OTP sensor be stored
+ * @param[in] locRawTemperature_i16   Temperature ADC value
+ * @param[in] locRawPressure_u32      Pressure ADC value
+ * @param[out] locTemperature_pf      Pointer to memory wher Temperature to be stored
+ * @param[out] locPressure_pf         Pointer to memory where Pressure to be stored
+ * @param[out] locAltitude_pf         Pointer to memory where Altitude to be stored
+ *
+ * @retval ICP_OK If the data was converted successfully. Otherwise, an error code is returned.
+ *
+ */
+ICPPress_State_t ICPPress_ProcessRawData(ICPPRess_Def_t *locICPPress_p, int16_t locRawTemperature_i16, uint32_t locRawPressure_u32, float *locTemperature_pf, float *locPressure_pf, float *locAltitude_pf);
+
+
+/**
+ * @brief Convert raw ADC values to temperature and pressure in integer arithmetic only.
+ *
+ * @param[in] locICPPress_p           Object where initialization data and data from OTP sensor be stored
+ * @param[in] locRawTemperature_i16   Temperature ADC value
+ * @param[in] locRawPressure_u32      Pressure ADC value
+ * @param[out] locTemperature_pi32    Pointer to memory where Temperature in 0.01 degree Celsius to be stored
+ * @param[out] locPressure_pu32       Pointer to memory where Pressure in 0.01 Pa to be stored
+ *
+ * @retval ICP_OK If the data was converted successfully. Otherwise, an error code is returned.
+ *
+ * @note The conversion constants are only recomputed when the raw temperature moved by more than
+ *       ICP_TEMPERATURE_CACHE_BAND, so consecutive samples mostly cost one division.
+ *
+ */
+ICPPress_State_t ICPPress_ProcessRawDataFixed(ICPPRess_Def_t *locICPPress_p, int16_t locRawTemperature_i16, uint32_t locRawPressure_u32, int32_t *locTemperature_pi32, uint32_t *locPressure_pu32);
  
 #ifdef __cplusplus
 }
@@ -0,0 +1,313 @@
+#include "sdk_common.h"
+#include "ble_aqs.h"
+#include <string.h>
+#include "ble_srv_common.h"
+#include "ble_conn_state.h"
+
+
+/**@brief Function for encoding the Air Quality Index value.
+ *
+ * @return      Length of the encoded value.
+ */
+static uint16_t iaq_encode(ble_aqs_iaq_t const * p_iaq, uint8_t * p_encoded)
+{
+    uint16_t len = 0;
+
+    len += uint16_encode(p_iaq->iaq, &p_encoded[len]);
+    len += uint16_encode(p_iaq->eco2, &p_encoded[len]);
+    len += uint16_encode(p_iaq->bvoc, &p_encoded[len]);
+    p_encoded[len++] = p_iaq->accuracy;
+
+    return len;
+}
+
+
+/**@brief Function for sending the value to a link it is pending on.
+ *
+ * @details A full SoftDevice queue leaves it pending, it is sent again on
+ *          BLE_GATTS_EVT_HVN_TX_COMPLETE of the link.
+ *
+ * @param[in]   p_aqs       Air Quality Service structure.
+ * @param[in]   conn_handle Connection handle of the link.
+ * @param[in]   p_client    Context of the link.
+ */
+static ret_code_t pending_flush(ble_aqs_t * p_aqs, uint16_t conn_handle, ble_aqs_client_context_t * p_client)
+{
+    ret_code_t             err_code;
+    ble_gatts_hvx_params_t hvx_params;
+    uint16_t               len = BLE_AQS_IAQ_LENGTH;
+
+    if (!p_client->pending)
+    {
+        return NRF_SUCCESS;
+    }
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+
+    hvx_params.handle = p_aqs->iaq_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.p_len  = &len;
+    hvx_params.p_data = p_aqs->iaq_last;
+
+    err_code = sd_ble_gatts_hvx(conn_handle, &hvx_params);
+    if ((err_code == NRF_ERROR_RESOURCES) || (err_code == NRF_ERROR_BUSY))
+    {
+        return NRF_SUCCESS;
+    }
+
+    p_client->pending = false;
+
+    if ((err_code == NRF_ERROR_INVALID_STATE) ||
+        (err_code == BLE_ERROR_GATTS_SYS_ATTR_MISSING))
+    {
+        // Notifications not enabled by the peer are not an error.
+        return NRF_SUCCESS;
+    }
+
+    return err_code;
+}
+
+
+/**@brief Function for marking the value pending on one link and sending it. */
+static ret_code_t link_notify(ble_aqs_t * p_aqs, uint16_t conn_handle)
+{
+    ret_code_t                 err_code;
+    ble_aqs_client_context_t * p_client = NULL;
+
+    err_code = blcm_link_ctx_get(p_aqs->p_link_ctx_storage, conn_handle, (void *) &p_client);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    if (!p_client->notification_enabled)
+    {
+        return NRF_SUCCESS;
+    }
+
+    // A value still pending from the last change is replaced, only the latest one goes out.
+    p_client->pending = true;
+
+    return pending_flush(p_aqs, conn_handle, p_client);
+}
+
+
+/**@brief Function for reading the CCCD of a link, e.g. restored from the bond of the peer. */
+static void cccd_refresh(ble_aqs_t * p_aqs, uint16_t conn_handle, ble_aqs_client_context_t * p_client)
+{
+    uint8_t           cccd_value[BLE_CCCD_VALUE_LEN];
+    ble_gatts_value_t gatts_val;
+
+    memset(&gatts_val, 0, sizeof(gatts_val));
+
+    gatts_val.p_value = cccd_value;
+    gatts_val.len     = sizeof(cccd_value);
+    gatts_val.offset  = 0;
+
+    p_client->notification_enabled =
+        (sd_ble_gatts_value_get(conn_handle, p_aqs->iaq_handles.cccd_handle, &gatts_val) == NRF_SUCCESS) &&
+        ble_srv_is_notification_enabled(cccd_value);
+}
+
+
+/**@brief Function for handling the Connect and Connection Security Update events.
+ *
+ * @details System attributes of a bonded peer may be applied once the link is encrypted.
+ */
+static void on_link_update(ble_aqs_t * p_aqs, ble_evt_t const * p_ble_evt, bool is_new)
+{
+    ble_aqs_client_context_t * p_client = NULL;
+    uint16_t                   conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+
+    if (blcm_link_ctx_get(p_aqs->p_link_ctx_storage, conn_handle, (void *) &p_client) != NRF_SUCCESS)
+    {
+        return;
+    }
+
+    if (is_new)
+    {
+        memset(p_client, 0, sizeof(*p_client));
+    }
+
+    cccd_refresh(p_aqs, conn_handle, p_client);
+}
+
+
+/**@brief Function for handling the Write event. */
+static void on_write(ble_aqs_t * p_aqs, ble_evt_t const * p_ble_evt)
+{
+    ble_gatts_evt_write_t const * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+    ble_aqs_client_context_t    * p_client    = NULL;
+
+    if ((p_evt_write->handle != p_aqs->iaq_handles.cccd_handle) ||
+        (p_evt_write->len != BLE_CCCD_VALUE_LEN) ||
+        (blcm_link_ctx_get(p_aqs->p_link_ctx_storage,
+                           p_ble_evt->evt.gatts_evt.conn_handle,
+                           (void *) &p_client) != NRF_SUCCESS))
+    {
+        return;
+    }
+
+    p_client->notification_enabled = ble_srv_is_notification_enabled(p_evt_write->data);
+    if (!p_client->notification_enabled)
+    {
+        p_client->pending = false;
+    }
+}
+
+
+/**@brief Function for handling the HVN TX Complete event. */
+static void on_hvn_tx_complete(ble_aqs_t * p_aqs, ble_evt_t const * p_ble_evt)
+{
+    ble_aqs_client_context_t * p_client = NULL;
+    uint16_t                   conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+
+    if ((blcm_link_ctx_get(p_aqs->p_link_ctx_storage, conn_handle, (void *) &p_client) == NRF_SUCCESS) &&
+        p_client->pending)
+    {
+        // Queue space was freed on this link, retry its deferred notification.
+        (void)pending_flush(p_aqs, conn_handle, p_client);
+    }
+}
+
+
+void ble_aqs_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    ble_aqs_t * p_aqs = (ble_aqs_t *) p_context;
+
+    if (p_aqs == NULL || p_ble_evt == NULL)
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            on_link_update(p_aqs, p_ble_evt, true);
+            break;
+        }
+
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:
+        {
+            on_link_update(p_aqs, p_ble_evt, false);
+            break;
+        }
+
+        case BLE_GATTS_EVT_WRITE:
+        {
+            on_write(p_aqs, p_ble_evt);
+            break;
+        }
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        {
+            on_hvn_tx_complete(p_aqs, p_ble_evt);
+            break;
+        }
+
+        default:
+        {
+            // No implementation needed.
+            break;
+        }
+    }
+}
+
+
+ret_code_t ble_aqs_init(ble_aqs_t * p_aqs, ble_aqs_init_t const * p_aqs_init)
+{
+    ret_code_t            err_code;
+    ble_uuid_t            ble_uuid;
+    ble_uuid128_t         base_uuid = BLE_AQS_BASE_UUID;
+    ble_add_char_params_t add_char_params;
+
+    if (p_aqs == NULL || p_aqs_init == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    // Initialize service structure, the link context storage is bound by BLE_AQS_DEF().
+    memset(p_aqs->iaq_last, 0, sizeof(p_aqs->iaq_last));
+
+    // Add service, the SoftDevice returns the existing UUID type if the base is registered already
+    err_code = sd_ble_uuid_vs_add(&base_uuid, &p_aqs->uuid_type);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    ble_uuid.type = p_aqs->uuid_type;
+    ble_uuid.uuid = BLE_UUID_AIR_QUALITY_SERVICE;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_aqs->service_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Add Air Quality Index characteristic
+    memset(&add_char_params, 0, sizeof(add_char_params));
+
+    add_char_params.uuid              = BLE_UUID_AIR_QUALITY_INDEX;
+    add_char_params.uuid_type         = p_aqs->uuid_type;
+    add_char_params.max_len           = BLE_AQS_IAQ_LENGTH;
+    add_char_params.init_len          = BLE_AQS_IAQ_LENGTH;
+    add_char_params.p_init_value      = p_aqs->iaq_last;
+    add_char_params.char_props.read   = 1;
+    add_char_params.char_props.notify = 1;
+    add_char_params.read_access       = p_aqs_init->iaq_rd_sec;
+    add_char_params.cccd_write_access = p_aqs_init->iaq_cccd_wr_sec;
+
+    return characteristic_add(p_aqs->service_handle, &add_char_params, &p_aqs->iaq_handles);
+}
+
+
+ret_code_t ble_aqs_iaq_update(ble_aqs_t * p_aqs, ble_aqs_iaq_t const * p_iaq, uint16_t conn_handle)
+{
+    ret_code_t                        err_code;
+    ble_gatts_value_t                 gatts_value;
+    ble_conn_state_conn_handle_list_t conn_handles;
+    uint8_t                           encoded[BLE_AQS_IAQ_LENGTH];
+
+    if (p_aqs == NULL || p_iaq == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+
+    gatts_value.len     = iaq_encode(p_iaq, encoded);
+    gatts_value.p_value = encoded;
+
+    if (memcmp(encoded, p_aqs->iaq_last, sizeof(encoded)) == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    err_code = sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, p_aqs->iaq_handles.value_handle, &gatts_value);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    memcpy(p_aqs->iaq_last, encoded, sizeof(encoded));
+
+    if (conn_handle != BLE_CONN_HANDLE_ALL)
+    {
+        return link_notify(p_aqs, conn_handle);
+    }
+
+    conn_handles = ble_conn_state_periph_handles();
+
+    for (uint32_t i = 0; i < conn_handles.len; i++)
+    {
+        err_code = link_notify(p_aqs, conn_handles.conn_handles[i]);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
+    }
+
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#ifndef BLE_AQS_H__
+#define BLE_AQS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_config.h"
+#include "ble.h"
+#include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+#include "ble_link_ctx_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Air Quality Service base UUID, shared with the Environmental Log Service so that it takes no extra vendor specific UUID slot. */
+#define BLE_AQS_BASE_UUID                           {{0x90, 0x8E, 0x6B, 0x2A, 0x1C, 0x3D, 0x41, 0x9E, \
+                                                      0x6A, 0x4F, 0x2F, 0x8B, 0x00, 0x00, 0x7D, 0x5C}}
+
+#define BLE_UUID_AIR_QUALITY_SERVICE                0x0010
+#define BLE_UUID_AIR_QUALITY_INDEX                  0x0011
+
+#define BLE_AQS_IAQ_LENGTH                          7       /**< Length of the encoded Air Quality Index value. */
+
+#define BLE_AQS_BLE_OBSERVER_PRIO                   2
+
+/**@brief Macro for defining a ble_aqs instance.
+ *
+ * @param   _name               Name of the instance.
+ * @param   _aqs_max_clients    Maximum number of AQS clients connected at a time.
+ * @hideinitializer
+ */
+#define BLE_AQS_DEF(_name, _aqs_max_clients)                      \
+    BLE_LINK_CTX_MANAGER_DEF(CONCAT_2(_name, _link_ctx_storage),  \
+                             (_aqs_max_clients),                  \
+                             sizeof(ble_aqs_client_context_t));   \
+    static ble_aqs_t _name =                                      \
+    {                                                             \
+        .p_link_ctx_storage = &CONCAT_2(_name, _link_ctx_storage) \
+    };                                                            \
+    NRF_SDH_BLE_OBSERVER(_name ## _obs,                           \
+                         BLE_AQS_BLE_OBSERVER_PRIO,               \
+                         ble_aqs_on_ble_evt,                      \
+                         &_name)
+
+/**@brief Air Quality Index value. */
+typedef struct
+{
+    uint16_t iaq;                                   /**< Index, 0 (clean) to 500. */
+    uint16_t eco2;                                  /**< CO2 equivalent, ppm. */
+    uint16_t bvoc;                                  /**< Breath VOC equivalent, ppb. */
+    uint8_t  accuracy;                              /**< 0 stabilizing to 3 calibrated. */
+} ble_aqs_iaq_t;
+
+/**@brief Air Quality Service init structure. */
+typedef struct
+{
+    security_req_t iaq_rd_sec;                      /**< Security requirement for reading the Air Quality Index. */
+    security_req_t iaq_cccd_wr_sec;                 /**< Security requirement for writing the Air Quality Index CCCD. */
+} ble_aqs_init_t;
+
+/**@brief Air Quality Service client context structure. */
+typedef struct
+{
+    bool notification_enabled;                      /**< The CCCD of the link enables notification. */
+    bool pending;                                   /**< The value changed but is not notified on the link yet. */
+} ble_aqs_client_context_t;
+
+/**@brief Air Quality Service structure. */
+typedef struct
+{
+    uint8_t                   uuid_type;            /**< UUID type of the vendor specific base UUID. */
+    uint16_t                  service_handle;       /**< Handle of Air Quality Service (as provided by the BLE stack). */
+    ble_gatts_char_handles_t  iaq_handles;          /**< Handles of the Air Quality Index characteristic. */
+    uint8_t                   iaq_last[BLE_AQS_IAQ_LENGTH]; /**< Value in the attribute table. */
+    blcm_link_ctx_storage_t * const p_link_ctx_storage; /**< Pointer to link context storage with handles of all current connections and its context. */
+} ble_aqs_t;
+
+
+/**@brief Function for initializing the Air Quality Service.
+ *
+ * @param[out]  p_aqs       Air Quality Service structure.
+ * @param[in]   p_aqs_init  Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on successful initialization of service, otherwise an error code.
+ */
+ret_code_t ble_aqs_init(ble_aqs_t * p_aqs, ble_aqs_init_t const * p_aqs_init);
+
+
+/**@brief Function for updating the Air Quality Index.
+ *
+ * @details The value is encoded as IAQ (uint16), eCO2 (uint16, ppm), bVOC (uint16, ppb) and
+ *          accuracy (uint8), little endian. Nothing happens if it did not change, otherwise it is
+ *          written to the attribute table and notified on every link whose CCCD enables it. A
+ *          notification that does not fit in the SoftDevice queue is kept pending and sent again
+ *          when a BLE_GATTS_EVT_HVN_TX_COMPLETE event frees the queue.
+ *
+ * @param[in]   p_aqs       Air Quality Service structure.
+ * @param[in]   p_iaq       New value.
+ * @param[in]   conn_handle Connection handle to notify on, or BLE_CONN_HANDLE_ALL for all
+ *                          connected peripheral links.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_aqs_iaq_update(ble_aqs_t * p_aqs, ble_aqs_iaq_t const * p_iaq, uint16_t conn_handle);
+
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ * @param[in]   p_context   Air Quality Service structure.
+ */
+void ble_aqs_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_AQS_H__
@@ -0,0 +1,639 @@
+#include "sdk_common.h"
+#include "ble_els.h"
+#include <string.h>
+#include "ble_srv_common.h"
+#include "ble_racp.h"
+#include "app_error.h"
+#include "datalog.h"
+
+#define RACP_RESPONSE_LENGTH            4       /**< Response Code: Op Code, Operator, request Op Code, response value. */
+#define RACP_SEQ_NUM_OPERAND_LENGTH     5       /**< Filter type followed by a 32-bit sequence number. */
+
+
+/**@brief Function for encoding a stored sample as a Log Record.
+ *
+ * @details Sequence number (uint32), timestamp in seconds since power on (uint32), temperature
+ *          (sint16, 0.01 C), humidity (uint16, 0.01 %), pressure (uint32, 0.1 Pa), elevation
+ *          (sint24, 0.01 m) and UV index (uint8), all little endian.
+ *
+ * @return      Length of the encoded record.
+ */
+static uint16_t record_encode(datalog_sample_t const * p_sample, uint8_t * p_encoded)
+{
+    uint16_t len = 0;
+
+    len += uint32_encode(p_sample->sequence, &p_encoded[len]);
+    len += uint32_encode(p_sample->timestamp, &p_encoded[len]);
+    len += uint16_encode((uint16_t)p_sample->temperature, &p_encoded[len]);
+    len += uint16_encode(p_sample->humidity, &p_encoded[len]);
+    len += uint32_encode(p_sample->pressure, &p_encoded[len]);
+    len += uint24_encode((uint32_t)p_sample->elevation, &p_encoded[len]);
+    p_encoded[len++] = p_sample->uv_index;
+
+    return len;
+}
+
+
+/**@brief Function for encoding the Diagnostics value.
+ *
+ * @return      Length of the encoded value.
+ */
+static uint16_t diagnostics_encode(ble_els_diagnostics_t const * p_diagnostics, uint8_t * p_encoded)
+{
+    uint16_t len = 0;
+
+    len += uint32_encode(p_diagnostics->wakeups, &p_encoded[len]);
+    len += uint32_encode(p_diagnostics->runs, &p_encoded[len]);
+    len += uint32_encode(p_diagnostics->wakeups_last_hour, &p_encoded[len]);
+    len += uint32_encode(p_diagnostics->runs_last_hour, &p_encoded[len]);
+    len += uint32_encode(p_diagnostics->heated_cycles, &p_encoded[len]);
+    len += uint32_encode(p_diagnostics->skipped_cycles, &p_encoded[len]);
+    len += uint32_encode(p_diagnostics->heater_saved_ms, &p_encoded[len]);
+
+    return len;
+}
+
+
+/**@brief Function for indicating a response on the Record Access Control Point.
+ *
+ * @param[in]   p_els       Environmental Log Service structure.
+ * @param[in]   p_racp_val  RACP value to be sent.
+ */
+static void racp_send(ble_els_t * p_els, ble_racp_value_t const * p_racp_val)
+{
+    ret_code_t             err_code;
+    uint8_t                encoded[RACP_RESPONSE_LENGTH];
+    uint16_t               len;
+    ble_gatts_hvx_params_t hvx_params;
+
+    len = ble_racp_encode(p_racp_val, encoded);
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+
+    hvx_params.handle = p_els->racp_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_INDICATION;
+    hvx_params.offset = 0;
+    hvx_params.p_len  = &len;
+    hvx_params.p_data = encoded;
+
+    err_code = sd_ble_gatts_hvx(p_els->conn_handle, &hvx_params);
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_INVALID_STATE) &&
+        (err_code != NRF_ERROR_BUSY) &&
+        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+}
+
+
+/**@brief Function for ending the running procedure, telling the application when a download stops. */
+static void procedure_end(ble_els_t * p_els)
+{
+    ble_els_evt_t evt;
+
+    if ((p_els->proc_opcode == RACP_OPCODE_REPORT_RECS) && (p_els->evt_handler != NULL))
+    {
+        evt.evt_type    = BLE_ELS_EVT_TRANSFER_FINISHED;
+        evt.conn_handle = p_els->conn_handle;
+
+        p_els->evt_handler(p_els, &evt);
+    }
+
+    p_els->proc_opcode = RACP_OPCODE_RESERVED;
+}
+
+
+/**@brief Function for sending a Response Code and ending the procedure.
+ *
+ * @param[in]   p_els       Environmental Log Service structure.
+ * @param[in]   opcode      Op Code of the request being answered.
+ * @param[in]   value       Response Code Value.
+ */
+static void racp_response_code_send(ble_els_t * p_els, uint8_t opcode, uint8_t value)
+{
+    ble_racp_value_t racp_response;
+    uint8_t          operand[2];
+
+    operand[0] = opcode;
+    operand[1] = value;
+
+    racp_response.opcode      = RACP_OPCODE_RESPONSE_CODE;
+    racp_response.operator    = RACP_OPERATOR_NULL;
+    racp_response.operand_len = sizeof(operand);
+    racp_response.p_operand   = operand;
+
+    racp_send(p_els, &racp_response);
+
+    procedure_end(p_els);
+}
+
+
+/**@brief Function for streaming records until the procedure ends or the SoftDevice queue is full.
+ *
+ * @details Continued on BLE_GATTS_EVT_HVN_TX_COMPLETE, so a long download goes out as
+ *          back to back notifications in as few connection events as the link allows.
+ *          Each notification carries as many whole records as the ATT MTU of the link fits.
+ */
+static void report_records_continue(ble_els_t * p_els)
+{
+    ret_code_t             err_code;
+    datalog_sample_t       sample;
+    uint8_t                encoded[BLE_ELS_RECORDS_PER_NOTIFICATION_MAX * BLE_ELS_RECORD_LENGTH];
+    uint16_t               len;
+    uint32_t               next;
+    uint8_t                count;
+    ble_gatts_hvx_params_t hvx_params;
+
+    while (p_els->proc_opcode == RACP_OPCODE_REPORT_RECS)
+    {
+        len   = 0;
+        count = 0;
+        next  = p_els->proc_next;
+
+        while ((count < p_els->proc_records_per_hvx) &&
+               (next < p_els->proc_end) &&
+               (datalog_read(next, &sample) == NRF_SUCCESS) &&
+               (sample.sequence < p_els->proc_end))
+        {
+            len += record_encode(&sample, &encoded[len]);
+            next = sample.sequence + 1;
+            count++;
+        }
+
+        if (count == 0)
+        {
+            racp_response_code_send(p_els,
+                                    RACP_OPCODE_REPORT_RECS,
+                                    (p_els->proc_reported != 0) ? RACP_RESPONSE_SUCCESS
+                                                                : RACP_RESPONSE_NO_RECORDS_FOUND);
+            return;
+        }
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = p_els->record_handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = encoded;
+
+        err_code = sd_ble_gatts_hvx(p_els->conn_handle, &hvx_params);
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            // Queue full, resumed on BLE_GATTS_EVT_HVN_TX_COMPLETE.
+            return;
+        }
+        if (err_code != NRF_SUCCESS)
+        {
+            racp_response_code_send(p_els, RACP_OPCODE_REPORT_RECS, RACP_RESPONSE_PROCEDURE_NOT_DONE);
+            return;
+        }
+
+        p_els->proc_next      = next;
+        p_els->proc_reported += count;
+    }
+}
+
+
+/**@brief Function for getting how many records fit in one notification on a link. */
+static uint8_t records_per_hvx_get(ble_els_t * p_els, uint16_t conn_handle)
+{
+    uint16_t att_mtu = BLE_GATT_ATT_MTU_DEFAULT;
+
+    if (p_els->p_gatt != NULL)
+    {
+        att_mtu = nrf_ble_gatt_eff_mtu_get(p_els->p_gatt, conn_handle);
+    }
+
+    return (uint8_t)MAX(1, MIN((att_mtu - 3) / BLE_ELS_RECORD_LENGTH, BLE_ELS_RECORDS_PER_NOTIFICATION_MAX));
+}
+
+
+/**@brief Function for reading the sequence number operand of a request.
+ *
+ * @return      RACP_RESPONSE_RESERVED if the operand is valid, otherwise the Response Code Value.
+ */
+static uint8_t seq_num_operand_get(ble_racp_value_t const * p_racp_request, uint32_t * p_seq_num)
+{
+    if (p_racp_request->operand_len != RACP_SEQ_NUM_OPERAND_LENGTH)
+    {
+        return RACP_RESPONSE_INVALID_OPERAND;
+    }
+    if (p_racp_request->p_operand[0] != BLE_ELS_OPERAND_FILTER_TYPE_SEQ_NUM)
+    {
+        return RACP_RESPONSE_OPERAND_UNSUPPORTED;
+    }
+
+    *p_seq_num = uint32_decode(&p_racp_request->p_operand[1]);
+
+    return RACP_RESPONSE_RESERVED;
+}
+
+
+/**@brief Function for translating the operator of a request into a sequence number range.
+ *
+ * @param[in]   p_racp_request  Request to be executed.
+ * @param[out]  p_next          First sequence number in the range.
+ * @param[out]  p_end           Sequence number after the range.
+ *
+ * @return      RACP_RESPONSE_RESERVED if the request is valid, otherwise the Response Code Value.
+ */
+static uint8_t request_range_get(ble_racp_value_t const * p_racp_request, uint32_t * p_next, uint32_t * p_end)
+{
+    uint32_t first;
+    uint32_t next;
+
+    datalog_range_get(&first, &next);
+
+    switch (p_racp_request->operator)
+    {
+        case RACP_OPERATOR_ALL:
+        case RACP_OPERATOR_FIRST:
+        case RACP_OPERATOR_LAST:
+            if (p_racp_request->operand_len != 0)
+            {
+                return RACP_RESPONSE_INVALID_OPERAND;
+            }
+            *p_next = (p_racp_request->operator == RACP_OPERATOR_LAST) ? next - 1 : first;
+            *p_end  = (p_racp_request->operator == RACP_OPERATOR_FIRST) ? first + 1 : next;
+            if (first == next)
+            {
+                *p_end = *p_next;
+            }
+            return RACP_RESPONSE_RESERVED;
+
+        case RACP_OPERATOR_GREATER_OR_EQUAL:
+            *p_end = next;
+            return seq_num_operand_get(p_racp_request, p_next);
+
+        case RACP_OPERATOR_NULL:
+            return RACP_RESPONSE_INVALID_OPERATOR;
+
+        default:
+            return RACP_RESPONSE_OPERATOR_UNSUPPORTED;
+    }
+}
+
+
+/**@brief Function for executing a Record Access Control Point request.
+ *
+ * @param[in]   p_els           Environmental Log Service structure.
+ * @param[in]   p_racp_request  Decoded request.
+ */
+static void racp_request_execute(ble_els_t * p_els, ble_racp_value_t const * p_racp_request)
+{
+    uint8_t  response;
+    uint32_t next = 0;
+    uint32_t end  = 0;
+
+    switch (p_racp_request->opcode)
+    {
+        case RACP_OPCODE_REPORT_RECS:
+            response = request_range_get(p_racp_request, &next, &end);
+            if (response != RACP_RESPONSE_RESERVED)
+            {
+                racp_response_code_send(p_els, p_racp_request->opcode, response);
+                break;
+            }
+
+            p_els->proc_opcode          = RACP_OPCODE_REPORT_RECS;
+            p_els->proc_next            = next;
+            p_els->proc_end             = end;
+            p_els->proc_reported        = 0;
+            p_els->proc_records_per_hvx = records_per_hvx_get(p_els, p_els->conn_handle);
+
+            if (p_els->evt_handler != NULL)
+            {
+                ble_els_evt_t evt;
+
+                evt.evt_type    = BLE_ELS_EVT_TRANSFER_STARTED;
+                evt.conn_handle = p_els->conn_handle;
+
+                p_els->evt_handler(p_els, &evt);
+            }
+
+            report_records_continue(p_els);
+            break;
+
+        case RACP_OPCODE_REPORT_NUM_RECS:
+            response = request_range_get(p_racp_request, &next, &end);
+            if (response != RACP_RESPONSE_RESERVED)
+            {
+                racp_response_code_send(p_els, p_racp_request->opcode, response);
+            }
+            else
+            {
+                ble_racp_value_t racp_response;
+                uint8_t          operand[sizeof(uint16_t)];
+                uint32_t         first;
+                uint32_t         count;
+
+                // Records before the oldest stored one are gone, do not count them.
+                datalog_range_get(&first, NULL);
+                next  = MAX(next, first);
+                count = (end > next) ? MIN(end - next, UINT16_MAX) : 0;
+
+                (void)uint16_encode((uint16_t)count, operand);
+
+                racp_response.opcode      = RACP_OPCODE_NUM_RECS_RESPONSE;
+                racp_response.operator    = RACP_OPERATOR_NULL;
+                racp_response.operand_len = sizeof(operand);
+                racp_response.p_operand   = operand;
+
+                racp_send(p_els, &racp_response);
+            }
+            break;
+
+        case RACP_OPCODE_DELETE_RECS:
+            // Blocks in flash hold several samples, so only the whole log can be deleted.
+            if (p_racp_request->operator != RACP_OPERATOR_ALL)
+            {
+                response = (p_racp_request->operator == RACP_OPERATOR_NULL) ? RACP_RESPONSE_INVALID_OPERATOR
+                                                                             : RACP_RESPONSE_OPERATOR_UNSUPPORTED;
+            }
+            else if (p_racp_request->operand_len != 0)
+            {
+                response = RACP_RESPONSE_INVALID_OPERAND;
+            }
+            else
+            {
+                response = (datalog_delete_all() == NRF_SUCCESS) ? RACP_RESPONSE_SUCCESS
+                                                                 : RACP_RESPONSE_PROCEDURE_NOT_DONE;
+            }
+            racp_response_code_send(p_els, p_racp_request->opcode, response);
+            break;
+
+        case RACP_OPCODE_ABORT_OPERATION:
+            if (p_racp_request->operator != RACP_OPERATOR_NULL)
+            {
+                response = RACP_RESPONSE_INVALID_OPERATOR;
+            }
+            else if (p_racp_request->operand_len != 0)
+            {
+                response = RACP_RESPONSE_INVALID_OPERAND;
+            }
+            else
+            {
+                response = RACP_RESPONSE_SUCCESS;
+            }
+            racp_response_code_send(p_els, p_racp_request->opcode, response);
+            break;
+
+        default:
+            racp_response_code_send(p_els, p_racp_request->opcode, RACP_RESPONSE_OPCODE_UNSUPPORTED);
+            break;
+    }
+}
+
+
+/**@brief Function for checking that a link enabled record notifications and RACP indications. */
+static bool is_cccd_configured(ble_els_t * p_els, uint16_t conn_handle)
+{
+    uint8_t           cccd_value[BLE_CCCD_VALUE_LEN];
+    ble_gatts_value_t gatts_value;
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+
+    gatts_value.len     = BLE_CCCD_VALUE_LEN;
+    gatts_value.offset  = 0;
+    gatts_value.p_value = cccd_value;
+
+    if ((sd_ble_gatts_value_get(conn_handle, p_els->record_handles.cccd_handle, &gatts_value) != NRF_SUCCESS) ||
+        !ble_srv_is_notification_enabled(cccd_value))
+    {
+        return false;
+    }
+
+    if ((sd_ble_gatts_value_get(conn_handle, p_els->racp_handles.cccd_handle, &gatts_value) != NRF_SUCCESS) ||
+        !ble_srv_is_indication_enabled(cccd_value))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+/**@brief Function for handling the Read/Write Authorization Request event.
+ *
+ * @details Writes to the Record Access Control Point are authorized so that requests arriving
+ *          while a procedure runs, or from a link that cannot receive the answer, are refused.
+ *
+ * @param[in]   p_els       Environmental Log Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_rw_authorize_request(ble_els_t * p_els, ble_evt_t const * p_ble_evt)
+{
+    ble_gatts_evt_rw_authorize_request_t const * p_req =
+        &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    uint16_t                                     conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+    ble_gatts_rw_authorize_reply_params_t        reply;
+    ble_racp_value_t                             racp_request;
+    ret_code_t                                   err_code;
+
+    if ((p_req->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE) ||
+        (p_req->request.write.op != BLE_GATTS_OP_WRITE_REQ) ||
+        (p_req->request.write.handle != p_els->racp_handles.value_handle))
+    {
+        return;
+    }
+
+    ble_racp_decode((uint8_t)p_req->request.write.len, p_req->request.write.data, &racp_request);
+
+    memset(&reply, 0, sizeof(reply));
+
+    reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    reply.params.write.update      = 1;
+    reply.params.write.offset      = p_req->request.write.offset;
+    reply.params.write.len         = p_req->request.write.len;
+    reply.params.write.p_data      = p_req->request.write.data;
+
+    if (!is_cccd_configured(p_els, conn_handle))
+    {
+        reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_CPS_CCCD_CONFIG_ERROR;
+    }
+    else if ((p_els->proc_opcode != RACP_OPCODE_RESERVED) &&
+             (racp_request.opcode != RACP_OPCODE_ABORT_OPERATION))
+    {
+        reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_CPS_PROC_ALR_IN_PROG;
+    }
+    else if ((p_els->proc_opcode != RACP_OPCODE_RESERVED) && (conn_handle != p_els->conn_handle))
+    {
+        // Only the link that started a procedure can abort it.
+        reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_CPS_PROC_ALR_IN_PROG;
+    }
+
+    err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &reply);
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_STATE))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+
+    if ((err_code != NRF_SUCCESS) || (reply.params.write.gatt_status != BLE_GATT_STATUS_SUCCESS))
+    {
+        return;
+    }
+
+    // An Abort Operation ends the running download before it is answered.
+    procedure_end(p_els);
+    p_els->conn_handle = conn_handle;
+
+    racp_request_execute(p_els, &racp_request);
+}
+
+
+void ble_els_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    ble_els_t * p_els = (ble_els_t *) p_context;
+
+    if (p_els == NULL || p_ble_evt == NULL)
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_DISCONNECTED:
+        {
+            if (p_ble_evt->evt.gap_evt.conn_handle == p_els->conn_handle)
+            {
+                p_els->conn_handle = BLE_CONN_HANDLE_INVALID;
+                p_els->proc_opcode = RACP_OPCODE_RESERVED;
+            }
+            break;
+        }
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        {
+            on_rw_authorize_request(p_els, p_ble_evt);
+            break;
+        }
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        {
+            if (p_ble_evt->evt.gatts_evt.conn_handle == p_els->conn_handle)
+            {
+                report_records_continue(p_els);
+            }
+            break;
+        }
+
+        default:
+        {
+            // No implementation needed.
+            break;
+        }
+    }
+}
+
+
+ret_code_t ble_els_init(ble_els_t * p_els, ble_els_init_t const * p_els_init)
+{
+    ret_code_t            err_code;
+    ble_uuid_t            ble_uuid;
+    ble_uuid128_t         base_uuid = BLE_ELS_BASE_UUID;
+    ble_add_char_params_t add_char_params;
+    uint8_t               initial_record[BLE_ELS_RECORD_LENGTH];
+    uint8_t               initial_diagnostics[BLE_ELS_DIAGNOSTICS_LENGTH];
+
+    if (p_els == NULL || p_els_init == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    memset(p_els, 0, sizeof(*p_els));
+
+    p_els->evt_handler = p_els_init->evt_handler;
+    p_els->p_gatt      = p_els_init->p_gatt;
+    p_els->conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_els->proc_opcode = RACP_OPCODE_RESERVED;
+
+    // Add service
+    err_code = sd_ble_uuid_vs_add(&base_uuid, &p_els->uuid_type);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    ble_uuid.type = p_els->uuid_type;
+    ble_uuid.uuid = BLE_UUID_ENVIRONMENTAL_LOG_SERVICE;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_els->service_handle);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Add Log Record characteristic, only ever notified, one or more records per value
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    memset(initial_record, 0, sizeof(initial_record));
+
+    add_char_params.uuid              = BLE_UUID_ENVIRONMENTAL_LOG_RECORD;
+    add_char_params.uuid_type         = p_els->uuid_type;
+    add_char_params.max_len           = BLE_ELS_RECORDS_PER_NOTIFICATION_MAX * BLE_ELS_RECORD_LENGTH;
+    add_char_params.init_len          = BLE_ELS_RECORD_LENGTH;
+    add_char_params.is_var_len        = true;
+    add_char_params.p_init_value      = initial_record;
+    add_char_params.char_props.notify = 1;
+    add_char_params.cccd_write_access = p_els_init->record_cccd_wr_sec;
+
+    err_code = characteristic_add(p_els->service_handle, &add_char_params, &p_els->record_handles);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Add Record Access Control Point characteristic
+    memset(&add_char_params, 0, sizeof(add_char_params));
+
+    add_char_params.uuid                = BLE_UUID_ENVIRONMENTAL_LOG_RACP;
+    add_char_params.uuid_type           = p_els->uuid_type;
+    add_char_params.max_len             = BLE_GATT_ATT_MTU_DEFAULT - 3;
+    add_char_params.is_var_len          = true;
+    add_char_params.char_props.indicate = 1;
+    add_char_params.char_props.write    = 1;
+    add_char_params.is_defered_write    = true;
+    add_char_params.write_access        = p_els_init->racp_wr_sec;
+    add_char_params.cccd_write_access   = p_els_init->racp_cccd_wr_sec;
+
+    err_code = characteristic_add(p_els->service_handle, &add_char_params, &p_els->racp_handles);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Add Diagnostics characteristic, read only, the application refreshes it
+    memset(&add_char_params, 0, sizeof(add_char_params));
+    memset(initial_diagnostics, 0, sizeof(initial_diagnostics));
+
+    add_char_params.uuid            = BLE_UUID_ENVIRONMENTAL_LOG_DIAGNOSTICS;
+    add_char_params.uuid_type       = p_els->uuid_type;
+    add_char_params.max_len         = BLE_ELS_DIAGNOSTICS_LENGTH;
+    add_char_params.init_len        = BLE_ELS_DIAGNOSTICS_LENGTH;
+    add_char_params.p_init_value    = initial_diagnostics;
+    add_char_params.char_props.read = 1;
+    add_char_params.read_access     = p_els_init->diagnostics_rd_sec;
+
+    return characteristic_add(p_els->service_handle, &add_char_params, &p_els->diagnostics_handles);
+}
+
+
+ret_code_t ble_els_diagnostics_update(ble_els_t * p_els, ble_els_diagnostics_t const * p_diagnostics)
+{
+    ble_gatts_value_t gatts_value;
+    uint8_t           encoded[BLE_ELS_DIAGNOSTICS_LENGTH];
+
+    if (p_els == NULL || p_diagnostics == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+
+    gatts_value.len     = diagnostics_encode(p_diagnostics, encoded);
+    gatts_value.p_value = encoded;
+
+    return sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, p_els->diagnostics_handles.value_handle, &gatts_value);
+}
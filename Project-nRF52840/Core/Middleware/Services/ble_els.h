@@ -0,0 +1,143 @@
+#ifndef BLE_ELS_H__
+#define BLE_ELS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_config.h"
+#include "ble.h"
+#include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+#include "nrf_ble_gatt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Environmental Log Service base UUID, 5c7d0000-8b2f-4f6a-9e41-3d1c2a6b8e90. */
+#define BLE_ELS_BASE_UUID                           {{0x90, 0x8E, 0x6B, 0x2A, 0x1C, 0x3D, 0x41, 0x9E, \
+                                                      0x6A, 0x4F, 0x2F, 0x8B, 0x00, 0x00, 0x7D, 0x5C}}
+
+#define BLE_UUID_ENVIRONMENTAL_LOG_SERVICE          0x0001
+#define BLE_UUID_ENVIRONMENTAL_LOG_RECORD           0x0002
+#define BLE_UUID_ENVIRONMENTAL_LOG_RACP             0x0003
+#define BLE_UUID_ENVIRONMENTAL_LOG_DIAGNOSTICS      0x0004
+
+#define BLE_ELS_BLE_OBSERVER_PRIO                   2
+
+#define BLE_ELS_OPERAND_FILTER_TYPE_SEQ_NUM         0x01    /**< RACP operand filter type: 32-bit sequence number. */
+#define BLE_ELS_RECORD_LENGTH                       20      /**< Length of one encoded log record, fits the default ATT MTU. */
+#define BLE_ELS_DIAGNOSTICS_LENGTH                  28      /**< Length of the encoded Diagnostics value, read with a long read at the default ATT MTU. */
+#define BLE_ELS_RECORDS_PER_NOTIFICATION_MAX        ((NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3) / BLE_ELS_RECORD_LENGTH) /**< Records packed into one notification at the largest ATT MTU. */
+
+/**@brief Macro for defining a ble_els instance.
+ *
+ * @param   _name  Name of the instance.
+ * @hideinitializer
+ */
+#define BLE_ELS_DEF(_name)                          \
+    static ble_els_t _name;                         \
+    NRF_SDH_BLE_OBSERVER(_name ## _obs,             \
+                         BLE_ELS_BLE_OBSERVER_PRIO, \
+                         ble_els_on_ble_evt,        \
+                         &_name)
+
+/**@brief Environmental Log Service event type. */
+typedef enum
+{
+    BLE_ELS_EVT_TRANSFER_STARTED,                   /**< A link started downloading records. */
+    BLE_ELS_EVT_TRANSFER_FINISHED,                  /**< The download ended, completed or aborted. */
+} ble_els_evt_type_t;
+
+/**@brief Environmental Log Service event. */
+typedef struct
+{
+    ble_els_evt_type_t evt_type;                    /**< Type of event. */
+    uint16_t           conn_handle;                 /**< Link running the download. */
+} ble_els_evt_t;
+
+/**@brief Power counters of a deployed unit, read back through the Diagnostics characteristic. */
+typedef struct
+{
+    uint32_t wakeups;                               /**< Sensor scheduler wakeups since start up. */
+    uint32_t runs;                                  /**< Sensor jobs run since start up. */
+    uint32_t wakeups_last_hour;                     /**< Sensor scheduler wakeups in the last complete hour. */
+    uint32_t runs_last_hour;                        /**< Sensor jobs run in the last complete hour. */
+    uint32_t heated_cycles;                         /**< BME680 cycles that ran the gas heater. */
+    uint32_t skipped_cycles;                        /**< BME680 cycles that skipped it. */
+    uint32_t heater_saved_ms;                       /**< Heater on time the skipped cycles saved. */
+} ble_els_diagnostics_t;
+
+// Forward declaration of the ble_els_t type.
+typedef struct ble_els_s ble_els_t;
+
+/**@brief Environmental Log Service event handler type. */
+typedef void (*ble_els_evt_handler_t) (ble_els_t * p_els, ble_els_evt_t * p_evt);
+
+/**@brief Environmental Log Service init structure. */
+typedef struct
+{
+    ble_els_evt_handler_t evt_handler;        /**< Event handler to be called for handling events in the Environmental Log Service. */
+    nrf_ble_gatt_t      * p_gatt;             /**< GATT module instance, used to size notifications to the ATT MTU of the link. */
+    security_req_t        record_cccd_wr_sec; /**< Security requirement for writing the Log Record CCCD. */
+    security_req_t        racp_cccd_wr_sec;   /**< Security requirement for writing the RACP CCCD. */
+    security_req_t        racp_wr_sec;        /**< Security requirement for writing the RACP. */
+    security_req_t        diagnostics_rd_sec; /**< Security requirement for reading the Diagnostics. */
+} ble_els_init_t;
+
+/**@brief Environmental Log Service structure. */
+struct ble_els_s
+{
+    ble_els_evt_handler_t     evt_handler;          /**< Event handler to be called for handling events in the Environmental Log Service. */
+    nrf_ble_gatt_t          * p_gatt;               /**< GATT module instance. */
+    uint8_t                   uuid_type;            /**< UUID type of the vendor specific base UUID. */
+    uint16_t                  service_handle;       /**< Handle of Environmental Log Service (as provided by the BLE stack). */
+    ble_gatts_char_handles_t  record_handles;       /**< Handles of the Log Record characteristic. */
+    ble_gatts_char_handles_t  racp_handles;         /**< Handles of the Record Access Control Point characteristic. */
+    ble_gatts_char_handles_t  diagnostics_handles;  /**< Handles of the Diagnostics characteristic. */
+    uint16_t                  conn_handle;          /**< Link running the RACP procedure, BLE_CONN_HANDLE_INVALID when idle. */
+    uint8_t                   proc_opcode;          /**< Op Code of the running procedure. */
+    uint32_t                  proc_next;            /**< Sequence number of the next record to report. */
+    uint32_t                  proc_end;             /**< Sequence number after the last record to report. */
+    uint32_t                  proc_reported;        /**< Records reported so far. */
+    uint8_t                   proc_records_per_hvx; /**< Records packed into each notification of the running procedure. */
+};
+
+
+/**@brief Function for initializing the Environmental Log Service.
+ *
+ * @details Stored samples are taken from the data log, which must be initialized separately.
+ *
+ * @param[out]  p_els       Environmental Log Service structure.
+ * @param[in]   p_els_init  Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on successful initialization of service, otherwise an error code.
+ */
+ret_code_t ble_els_init(ble_els_t * p_els, ble_els_init_t const * p_els_init);
+
+
+/**@brief Function for updating the Diagnostics characteristic.
+ *
+ * @details The counters are written to the attribute table only, a client reads them on demand.
+ *          They are encoded as seven uint32, in @ref ble_els_diagnostics_t order, little endian.
+ *
+ * @param[in]   p_els           Environmental Log Service structure.
+ * @param[in]   p_diagnostics   New counters.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t ble_els_diagnostics_update(ble_els_t * p_els, ble_els_diagnostics_t const * p_diagnostics);
+
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ * @param[in]   p_context   Environmental Log Service structure.
+ */
+void ble_els_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_ELS_H__
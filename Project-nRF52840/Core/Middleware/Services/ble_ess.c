@@ -3,6 +3,7 @@
 #include <string.h>
 #include "ble_srv_common.h"
 #include "ble_conn_state.h"
+#include "app_timer.h"
 
 #define MAX_WIN_DIRECTION_LENGTH          2
 #define MAX_WIN_SPEED_LENGTH              2
@@ -15,2003 +16,969 @@
 #define MAX_TEMPERATURE_LENGTH            2
 #define MAX_MAGNETIC_DECLINATION_LENGTH   2
 #define MAX_MAGNETIC_FLUX_DENSITY_LENGTH  2
+#define MAX_VALUE_LENGTH                  (MAX_MAGNETIC_FLUX_DENSITY_LENGTH * BLE_ESS_MAX_COMPONENTS)
+#define MAX_TRIGGER_SETTING_LENGTH        (1 + MAX_VALUE_LENGTH)
 
-static ret_code_t support_descriptor_add(uint16_t char_handle);
+#define TRIGGER_INTERVAL_LENGTH           3
+#define TRIGGER_TICKS_PER_SECOND          (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
 
+#define ESS_ATTERR_WRITE_REQUEST_REJECTED   (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 0x00)  /**< ESS application error: Write Request Rejected. */
+#define ESS_ATTERR_CONDITION_NOT_SUPPORTED  (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 0x01)  /**< ESS application error: Condition not supported. */
 
-/**@brief Function for handling the Connect event.
- *
- * @param[in]   p_ess       Environmental Sensing Service structure.
- * @param[in]   p_ble_evt   Event received from the BLE stack.
- */
-static void on_connect(ble_ess_t * p_ess, ble_evt_t const * p_ble_evt)
-{
-    p_ess->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
-}
-
-
-/**@brief Function for handling the Disconnect event.
- *
- * @param[in]   p_ess       Environmental Sensing Service structure.
- * @param[in]   p_ble_evt   Event received from the BLE stack.
- */
-static void on_disconnect(ble_ess_t * p_ess, ble_evt_t const * p_ble_evt)
-{
-    UNUSED_PARAMETER(p_ble_evt);
-    p_ess->conn_handle = BLE_CONN_HANDLE_INVALID;
-}
-
-
-void ble_ess_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
-{
-    ble_ess_t * p_ess = (ble_ess_t *) p_context;
-    
-    if (p_ess == NULL || p_ble_evt == NULL)
-    {
-        return;
-    }
-
-    switch (p_ble_evt->header.evt_id)
-    {
-        case BLE_GAP_EVT_CONNECTED:
-        {
-            on_connect(p_ess, p_ble_evt);
-            break;
-        }
-
-        case BLE_GAP_EVT_DISCONNECTED:
-        {
-            on_disconnect(p_ess, p_ble_evt);
-            break;
-        }
-
-        case BLE_GATTS_EVT_WRITE:
-        {
-           break;
-        }
-
-        default:
-        {
-            // No implementation needed.
-            break;
-        }
-    }
-}
-
-
-static ret_code_t support_descriptor_add(uint16_t char_handle)
-{
-    ret_code_t err_code;
-
-    ble_add_descr_params_t add_char_descriptor_params;
-
-    // Add Environmental Sensing Measurement desriptor
-    memset(&add_char_descriptor_params, 0, sizeof(add_char_descriptor_params));
-
-    add_char_descriptor_params.uuid = 0x290C;
-    add_char_descriptor_params.p_value = "ES Measurement";
-    add_char_descriptor_params.read_access = 1;
-
-    err_code = descriptor_add(char_handle,
-                              &add_char_descriptor_params,
-                              NULL);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Environmental Sensing Trigger Setting desriptor
-    memset(&add_char_descriptor_params, 0, sizeof(add_char_descriptor_params));
-
-    add_char_descriptor_params.uuid = 0x290D;
-    add_char_descriptor_params.p_value = "ES Trigger Setting";
-    add_char_descriptor_params.read_access = 1;
-
-    err_code = descriptor_add(char_handle,
-                              &add_char_descriptor_params,
-                              NULL);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Environmental Sensing Configuration desriptor
-    memset(&add_char_descriptor_params, 0, sizeof(add_char_descriptor_params));
-
-    add_char_descriptor_params.uuid = 0x290B;
-    add_char_descriptor_params.p_value = "ES Configuration";
-    add_char_descriptor_params.read_access = 1;
-
-    err_code = descriptor_add(char_handle,
-                              &add_char_descriptor_params,
-                              NULL);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Valid Range desriptor
-    memset(&add_char_descriptor_params, 0, sizeof(add_char_descriptor_params));
-
-    add_char_descriptor_params.uuid = 0x2906;
-    add_char_descriptor_params.p_value = "Valid Range";
-    add_char_descriptor_params.read_access = 1;
-
-    err_code = descriptor_add(char_handle,
-                              &add_char_descriptor_params,
-                              NULL);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    return err_code;
-}
-
-
-ret_code_t ble_ess_init(ble_ess_t * p_ess, const ble_ess_init_t * p_ess_init)
-{
-    int8_t  initial_dew_point;
-    int8_t  initial_heat_index;
-    int8_t  initial_wind_chill;
-    uint8_t initial_gust_factor;
-    uint8_t initial_uv_index;
-    uint8_t initial_barometric_pressure_trend;
-    uint8_t initial_apparent_wind_direction[MAX_WIN_DIRECTION_LENGTH];
-    uint8_t initial_apparent_wind_speed[MAX_WIN_SPEED_LENGTH];
-    uint8_t initial_elevation[MAX_ELEVATION_LENGTH];
-    uint8_t initial_humidity[MAX_HUMIDITY_LENGTH];
-    uint8_t initial_irradiance[MAX_IRRADIANCE_LENGTH];
-    uint8_t initial_pollen_concentration[MAX_POLLEN_CONCENTRATION_LENGTH];
-    uint8_t initial_rainfall[MAX_RAINFALL_LENGTH];
-    uint8_t initial_pressure[MAX_PRESSURE_LENGTH];
-    uint8_t initial_temperature[MAX_TEMPERATURE_LENGTH];
-    uint8_t initial_true_wind_direction[MAX_WIN_DIRECTION_LENGTH];
-    uint8_t initial_true_wind_speed[MAX_WIN_SPEED_LENGTH];
-    uint8_t initial_magnetic_declination[MAX_MAGNETIC_DECLINATION_LENGTH];
-    uint8_t initial_magnetic_flux_density_2d[MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 2];
-    uint8_t initial_magnetic_flux_density_3d[MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 3];
-    ret_code_t err_code;
-    ble_uuid_t ble_uuid;
-    ble_add_char_params_t add_char_params;
-    ble_add_char_user_desc_t user_descr_params;
-
-    if (p_ess == NULL || p_ess_init == NULL)
-    {
-        return NRF_ERROR_NULL;
-    }
-
-    // Initialize service structure
-    p_ess->evt_handler                    = p_ess_init->evt_handler;
-    p_ess->is_dc_notification_supported   = p_ess_init->support_dc_notification;
-    p_ess->is_dc_writable_aux_supported   = p_ess_init->support_dc_writable_aux;
-    p_ess->is_awd_notification_supported  = p_ess_init->support_awd_notification;
-    p_ess->is_awd_writable_aux_supported  = p_ess_init->support_awd_writable_aux;
-    p_ess->is_aws_notification_supported  = p_ess_init->support_aws_notification;
-    p_ess->is_aws_writable_aux_supported  = p_ess_init->support_aws_writable_aux;
-    p_ess->is_dp_notification_supported   = p_ess_init->support_dp_notification;
-    p_ess->is_dp_writable_aux_supported   = p_ess_init->support_dp_writable_aux;
-    p_ess->is_el_notification_supported   = p_ess_init->support_el_notification;
-    p_ess->is_el_writable_aux_supported   = p_ess_init->support_el_writable_aux;
-    p_ess->is_gf_notification_supported   = p_ess_init->support_gf_notification;
-    p_ess->is_gf_writable_aux_supported   = p_ess_init->support_gf_writable_aux;
-    p_ess->is_hi_notification_supported   = p_ess_init->support_hi_notification;
-    p_ess->is_hi_writable_aux_supported   = p_ess_init->support_hi_writable_aux;
-    p_ess->is_hum_notification_supported  = p_ess_init->support_hum_notification;
-    p_ess->is_hum_writable_aux_supported  = p_ess_init->support_hum_writable_aux;
-    p_ess->is_ird_notification_supported  = p_ess_init->support_ird_notification;
-    p_ess->is_ird_writable_aux_supported  = p_ess_init->support_ird_writable_aux;
-    p_ess->is_pc_notification_supported   = p_ess_init->support_pc_notification;
-    p_ess->is_pc_writable_aux_supported   = p_ess_init->support_pc_writable_aux;
-    p_ess->is_rf_notification_supported   = p_ess_init->support_rf_notification;
-    p_ess->is_rf_writable_aux_supported   = p_ess_init->support_rf_writable_aux;
-    p_ess->is_ps_notification_supported   = p_ess_init->support_ps_notification;
-    p_ess->is_ps_writable_aux_supported   = p_ess_init->support_ps_writable_aux;
-    p_ess->is_tem_notification_supported  = p_ess_init->support_tem_notification;
-    p_ess->is_tem_writable_aux_supported  = p_ess_init->support_tem_writable_aux;
-    p_ess->is_twd_notification_supported  = p_ess_init->support_twd_notification;
-    p_ess->is_twd_writable_aux_supported  = p_ess_init->support_twd_writable_aux;
-    p_ess->is_tws_notification_supported  = p_ess_init->support_tws_notification;
-    p_ess->is_tws_writable_aux_supported  = p_ess_init->support_tws_writable_aux;
-    p_ess->is_uvi_notification_supported  = p_ess_init->support_uvi_notification;
-    p_ess->is_uvi_writable_aux_supported  = p_ess_init->support_uvi_writable_aux;
-    p_ess->is_wc_notification_supported   = p_ess_init->support_wc_notification;
-    p_ess->is_wc_writable_aux_supported   = p_ess_init->support_wc_writable_aux;
-    p_ess->is_bpt_notification_supported  = p_ess_init->support_bpt_notification;
-    p_ess->is_bpt_writable_aux_supported  = p_ess_init->support_bpt_writable_aux;
-    p_ess->is_md_notification_supported   = p_ess_init->support_md_notification;
-    p_ess->is_md_writable_aux_supported   = p_ess_init->support_md_writable_aux;
-    p_ess->is_mfd2d_notification_supported  = p_ess_init->support_mfd2d_notification;
-    p_ess->is_mfd2d_writable_aux_supported  = p_ess_init->support_mfd2d_writable_aux;
-    p_ess->is_mfd3d_notification_supported  = p_ess_init->support_mfd3d_notification;
-    p_ess->is_mfd3d_writable_aux_supported  = p_ess_init->support_mfd3d_writable_aux;
-    p_ess->conn_handle                    = BLE_CONN_HANDLE_INVALID;
-
-    initial_dew_point               = p_ess_init->initial_dew_point;
-    initial_gust_factor             = p_ess_init->initial_gust_factor;
-    initial_heat_index              = p_ess_init->initial_heat_index;
-    initial_uv_index                = p_ess_init->initial_uv_index;
-    initial_wind_chill              = p_ess_init->initial_wind_chill;
-    initial_barometric_pressure_trend = p_ess_init->initial_barometric_pressure_trend;
-
-    uint16_encode(p_ess_init->initial_apparent_wind_direction, initial_apparent_wind_direction);
-    uint16_encode(p_ess_init->initial_apparent_wind_speed, initial_apparent_wind_speed);
-    uint24_encode(p_ess_init->initial_elevation, initial_elevation);
-    uint16_encode(p_ess_init->initial_humidity, initial_humidity);
-    uint16_encode(p_ess_init->initial_irradiance, initial_irradiance);
-    uint24_encode(p_ess_init->initial_pollen_concentration, initial_pollen_concentration);
-    uint16_encode(p_ess_init->initial_rainfall, initial_rainfall);
-    uint32_encode(p_ess_init->initial_pressure, initial_pressure);
-    uint16_encode(p_ess_init->initial_temperature, initial_temperature);
-    uint16_encode(p_ess_init->initial_true_wind_direction, initial_true_wind_direction);
-    uint16_encode(p_ess_init->initial_true_wind_speed, initial_true_wind_speed);
-    uint16_encode(p_ess_init->initial_magnetic_declination, initial_magnetic_declination);
-    uint16_encode(p_ess_init->initial_magnetic_flux_density_2d.magnetic_flux_density_x, &initial_magnetic_flux_density_2d[0]);
-    uint16_encode(p_ess_init->initial_magnetic_flux_density_2d.magnetic_flux_density_y, &initial_magnetic_flux_density_2d[2]);
-    uint16_encode(p_ess_init->initial_magnetic_flux_density_3d.magnetic_flux_density_y, &initial_magnetic_flux_density_3d[0]);
-    uint16_encode(p_ess_init->initial_magnetic_flux_density_3d.magnetic_flux_density_x, &initial_magnetic_flux_density_3d[2]);
-    uint16_encode(p_ess_init->initial_magnetic_flux_density_3d.magnetic_flux_density_z, &initial_magnetic_flux_density_3d[4]);
-
-    // Add service
-    BLE_UUID_BLE_ASSIGN(ble_uuid, BLE_UUID_ENVIRONMENTAL_SENSING_SERVICE);
-
-    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_ess->service_handle);
-
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Descriptor Value Changed characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_DESCRIPTOR_VALUE_CHANGED;
-    add_char_params.char_props.notify     = p_ess->is_dc_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_dc_writable_aux_supported;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->dc_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Configure User Descriptor parameters
-    memset(&user_descr_params, 0, sizeof(user_descr_params));
-    user_descr_params.p_char_user_desc = "Characteristic User Description";
-    user_descr_params.read_access = SEC_OPEN;
-
-    // Add Apparent Wind Direction characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_APPARENT_WIND_DIRECTION;
-    add_char_params.max_len               = MAX_WIN_DIRECTION_LENGTH;
-    add_char_params.init_len              = MAX_WIN_DIRECTION_LENGTH;
-    add_char_params.p_init_value          = initial_apparent_wind_direction;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_awd_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_awd_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->awd_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->awd_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->awd_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->awd_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Apparent Wind Speed characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_APPARENT_WIND_SPEED;
-    add_char_params.max_len               = MAX_WIN_SPEED_LENGTH;
-    add_char_params.init_len              = MAX_WIN_SPEED_LENGTH;
-    add_char_params.p_init_value          = initial_apparent_wind_speed;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_aws_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_aws_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->aws_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->aws_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->aws_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->aws_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Dew Point characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_DEW_POINT;
-    add_char_params.max_len               = sizeof(int8_t);
-    add_char_params.init_len              = sizeof(int8_t);
-    add_char_params.p_init_value          = &initial_dew_point;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_dp_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_dp_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->dp_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->dp_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->dp_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->dp_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Elevation characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_ELEVATION;
-    add_char_params.max_len               = MAX_ELEVATION_LENGTH;
-    add_char_params.init_len              = MAX_ELEVATION_LENGTH;
-    add_char_params.p_init_value          = initial_elevation;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_el_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_el_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->el_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->el_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->el_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->el_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Gust Factor characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_GUST_FACTOR;
-    add_char_params.max_len               = sizeof(uint8_t);
-    add_char_params.init_len              = sizeof(uint8_t);
-    add_char_params.p_init_value          = &initial_gust_factor;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_gf_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_gf_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->gf_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->gf_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->gf_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->gf_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Heat Index characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_HEAT_INDEX;
-    add_char_params.max_len               = sizeof(int8_t);
-    add_char_params.init_len              = sizeof(int8_t);
-    add_char_params.p_init_value          = &initial_heat_index;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_hi_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_hi_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->hi_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->hi_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->hi_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->hi_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Humidity characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_HUMIDITY;
-    add_char_params.max_len               = MAX_HUMIDITY_LENGTH;
-    add_char_params.init_len              = MAX_HUMIDITY_LENGTH;
-    add_char_params.p_init_value          = initial_humidity;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_hum_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_hum_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->hum_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->hum_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->hum_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->hum_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Irradiance characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_IRRADIANCE;
-    add_char_params.max_len               = MAX_IRRADIANCE_LENGTH;
-    add_char_params.init_len              = MAX_IRRADIANCE_LENGTH;
-    add_char_params.p_init_value          = initial_irradiance;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_ird_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_ird_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->ird_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->ird_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->ird_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->ird_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Pollen Concentration characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_POLLEN_CONCENTRATION;
-    add_char_params.max_len               = MAX_POLLEN_CONCENTRATION_LENGTH;
-    add_char_params.init_len              = MAX_POLLEN_CONCENTRATION_LENGTH;
-    add_char_params.p_init_value          = initial_pollen_concentration;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_pc_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_pc_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->pc_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->pc_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->pc_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->pc_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Rainfall characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_RAINFALL;
-    add_char_params.max_len               = MAX_RAINFALL_LENGTH;
-    add_char_params.init_len              = MAX_RAINFALL_LENGTH;
-    add_char_params.p_init_value          = initial_rainfall;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_rf_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_rf_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->rf_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->rf_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->rf_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->rf_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Pressure characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_PRESSURE;
-    add_char_params.max_len               = MAX_PRESSURE_LENGTH;
-    add_char_params.init_len              = MAX_PRESSURE_LENGTH;
-    add_char_params.p_init_value          = initial_pressure;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_ps_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_ps_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->ps_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->ps_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->ps_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->ps_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Temperature characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_TEMPERATURE;
-    add_char_params.max_len               = MAX_TEMPERATURE_LENGTH;
-    add_char_params.init_len              = MAX_TEMPERATURE_LENGTH;
-    add_char_params.p_init_value          = initial_temperature;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_tem_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_tem_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->tem_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->tem_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->tem_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->tem_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add True Wind Direction characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_TRUE_WIND_DIRECTION;
-    add_char_params.max_len               = MAX_WIN_DIRECTION_LENGTH;
-    add_char_params.init_len              = MAX_WIN_DIRECTION_LENGTH;
-    add_char_params.p_init_value          = initial_true_wind_direction;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_twd_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_twd_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->twd_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->twd_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->twd_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->twd_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add True Wind Speed characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_TRUE_WIND_SPEED;
-    add_char_params.max_len               = MAX_WIN_SPEED_LENGTH;
-    add_char_params.init_len              = MAX_WIN_SPEED_LENGTH;
-    add_char_params.p_init_value          = initial_true_wind_speed;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_tws_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_tws_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->tws_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->tws_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->tws_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->tws_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add UV Index characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_UV_INDEX;
-    add_char_params.max_len               = sizeof(uint8_t);
-    add_char_params.init_len              = sizeof(uint8_t);
-    add_char_params.p_init_value          = &initial_uv_index;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_uvi_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_uvi_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->uvi_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->uvi_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->uvi_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->uvi_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Wind Chill characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_WIND_CHILL;
-    add_char_params.max_len               = sizeof(int8_t);
-    add_char_params.init_len              = sizeof(int8_t);
-    add_char_params.p_init_value          = &initial_wind_chill;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_wc_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_wc_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->wc_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->wc_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->wc_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->wc_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Barometric Pressure Trend characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_BAROMETRIC_PRESSURE_TREND;
-    add_char_params.max_len               = sizeof(uint8_t);
-    add_char_params.init_len              = sizeof(uint8_t);
-    add_char_params.p_init_value          = &initial_barometric_pressure_trend;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_bpt_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_bpt_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->bpt_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->bpt_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->bpt_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->bpt_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Magnetic Declination characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_MAGNETIC_DECLINATION;
-    add_char_params.max_len               = MAX_MAGNETIC_DECLINATION_LENGTH;
-    add_char_params.init_len              = MAX_MAGNETIC_DECLINATION_LENGTH;
-    add_char_params.p_init_value          = initial_magnetic_declination;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_md_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_md_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->md_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->md_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->md_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->md_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Magnetic Flux Density 2D characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
-
-    add_char_params.uuid                  = BLE_UUID_MAGNETIC_FLUX_DENSITY_2D;
-    add_char_params.max_len               = MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 2;
-    add_char_params.init_len              = MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 2;
-    add_char_params.p_init_value          = initial_magnetic_flux_density_2d;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_mfd2d_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_mfd2d_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->mfd2d_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->mfd2d_rd_sec;
-
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->mfd2d_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    err_code = support_descriptor_add(p_ess->mfd2d_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
-
-    // Add Magnetic Flux Density 3D characteristic
-    memset(&add_char_params, 0, sizeof(add_char_params));
+/**@brief Static description of a measurement characteristic. */
+typedef struct
+{
+    uint16_t uuid;                      /**< Characteristic UUID. */
+    uint8_t  length;                    /**< Length of one encoded component in bytes. */
+    uint8_t  components;                /**< Number of components. */
+    bool     is_signed;                 /**< TRUE if the components are signed. */
+} char_desc_t;
 
-    add_char_params.uuid                  = BLE_UUID_MAGNETIC_FLUX_DENSITY_3D;
-    add_char_params.max_len               = MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 3;
-    add_char_params.init_len              = MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 3;
-    add_char_params.p_init_value          = initial_magnetic_flux_density_3d;
-    add_char_params.char_props.read       = 1;
-    add_char_params.char_props.notify     = p_ess->is_mfd3d_notification_supported;
-    add_char_params.char_ext_props.wr_aux = p_ess->is_mfd3d_writable_aux_supported;
-    add_char_params.p_user_descr          = &user_descr_params;
-    add_char_params.cccd_write_access     = p_ess_init->mfd3d_cccd_wr_sec;
-    add_char_params.read_access           = p_ess_init->mfd3d_rd_sec;
+static const char_desc_t m_char_desc[BLE_ESS_CHAR_COUNT] =
+{
+    [BLE_ESS_CHAR_AWD]   = {BLE_UUID_APPARENT_WIND_DIRECTION,   MAX_WIN_DIRECTION_LENGTH,          1, false},
+    [BLE_ESS_CHAR_AWS]   = {BLE_UUID_APPARENT_WIND_SPEED,       MAX_WIN_SPEED_LENGTH,              1, false},
+    [BLE_ESS_CHAR_DP]    = {BLE_UUID_DEW_POINT,                 sizeof(int8_t),                    1, true },
+    [BLE_ESS_CHAR_EL]    = {BLE_UUID_ELEVATION,                 MAX_ELEVATION_LENGTH,              1, true },
+    [BLE_ESS_CHAR_GF]    = {BLE_UUID_GUST_FACTOR,               sizeof(uint8_t),                   1, false},
+    [BLE_ESS_CHAR_HI]    = {BLE_UUID_HEAT_INDEX,                sizeof(int8_t),                    1, true },
+    [BLE_ESS_CHAR_HUM]   = {BLE_UUID_HUMIDITY,                  MAX_HUMIDITY_LENGTH,               1, false},
+    [BLE_ESS_CHAR_IRD]   = {BLE_UUID_IRRADIANCE,                MAX_IRRADIANCE_LENGTH,             1, false},
+    [BLE_ESS_CHAR_PC]    = {BLE_UUID_POLLEN_CONCENTRATION,      MAX_POLLEN_CONCENTRATION_LENGTH,   1, false},
+    [BLE_ESS_CHAR_RF]    = {BLE_UUID_RAINFALL,                  MAX_RAINFALL_LENGTH,               1, false},
+    [BLE_ESS_CHAR_PS]    = {BLE_UUID_PRESSURE,                  MAX_PRESSURE_LENGTH,               1, false},
+    [BLE_ESS_CHAR_TEM]   = {BLE_UUID_TEMPERATURE,               MAX_TEMPERATURE_LENGTH,            1, true },
+    [BLE_ESS_CHAR_TWD]   = {BLE_UUID_TRUE_WIND_DIRECTION,       MAX_WIN_DIRECTION_LENGTH,          1, false},
+    [BLE_ESS_CHAR_TWS]   = {BLE_UUID_TRUE_WIND_SPEED,           MAX_WIN_SPEED_LENGTH,              1, false},
+    [BLE_ESS_CHAR_UVI]   = {BLE_UUID_UV_INDEX,                  sizeof(uint8_t),                   1, false},
+    [BLE_ESS_CHAR_WC]    = {BLE_UUID_WIND_CHILL,                sizeof(int8_t),                    1, true },
+    [BLE_ESS_CHAR_BPT]   = {BLE_UUID_BAROMETRIC_PRESSURE_TREND, sizeof(uint8_t),                   1, false},
+    [BLE_ESS_CHAR_MD]    = {BLE_UUID_MAGNETIC_DECLINATION,      MAX_MAGNETIC_DECLINATION_LENGTH,   1, false},
+    [BLE_ESS_CHAR_MFD2D] = {BLE_UUID_MAGNETIC_FLUX_DENSITY_2D,  MAX_MAGNETIC_FLUX_DENSITY_LENGTH,  2, true },
+    [BLE_ESS_CHAR_MFD3D] = {BLE_UUID_MAGNETIC_FLUX_DENSITY_3D,  MAX_MAGNETIC_FLUX_DENSITY_LENGTH,  3, true },
+};
+
+/**@brief Characteristic of each snapshot field, in BLE_ESS_SNAPSHOT_* bit order. */
+static const ble_ess_char_t m_snapshot_char[BLE_ESS_SNAPSHOT_COUNT] =
+{
+    BLE_ESS_CHAR_EL,
+    BLE_ESS_CHAR_HUM,
+    BLE_ESS_CHAR_PS,
+    BLE_ESS_CHAR_TEM,
+    BLE_ESS_CHAR_UVI
+};
 
-    err_code = characteristic_add(p_ess->service_handle,
-                                  &add_char_params,
-                                  &(p_ess->mfd3d_handles));
-    if (err_code != NRF_SUCCESS)
-    {
-        return err_code;
-    }
 
-    err_code = support_descriptor_add(p_ess->mfd3d_handles.value_handle);
-    if (err_code != NRF_SUCCESS)
+/**@brief Function for finding the runtime state of a characteristic.
+ *
+ * @return      Pointer to the state, NULL if the characteristic is not built in.
+ */
+static ble_ess_char_ctx_t * char_ctx_get(ble_ess_t * p_ess, ble_ess_char_t characteristic)
+{
+    if ((characteristic >= BLE_ESS_CHAR_COUNT) || !BLE_ESS_CHAR_IS_ENABLED(characteristic))
     {
-        return err_code;
+        return NULL;
     }
 
-    return err_code;
+    // Slots are packed in enum order, so the slot is the number of enabled characteristics before it.
+    return &p_ess->chars[BLE_ESS_BIT_COUNT(BLE_ESS_CONFIG_CHAR_MASK & (BLE_ESS_CHAR_BIT(characteristic) - 1))];
 }
 
 
-ret_code_t ble_ess_apparent_wind_direction_update(ble_ess_t * p_ess,
-                                                  uint16_t    apparent_wind_direction)
+/**@brief Function for encoding a value in the format of its characteristic.
+ *
+ * @param[in]   characteristic  Characteristic the value belongs to.
+ * @param[in]   p_value         Components of the value.
+ * @param[out]  p_encoded       Encoded value, at least MAX_VALUE_LENGTH bytes.
+ *
+ * @return      Length of the encoded value.
+ */
+static uint16_t char_value_encode(ble_ess_char_t characteristic, int32_t const * p_value, uint8_t * p_encoded)
 {
-    if (p_ess == NULL)
-    {
-        return NRF_ERROR_NULL;
-    }
-
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
+    char_desc_t const * p_desc = &m_char_desc[characteristic];
+    uint16_t            len    = 0;
 
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (uint32_t i = 0; i < p_desc->components; i++)
     {
-        uint8_t encodded_apparent_wind_direction[MAX_WIN_DIRECTION_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint16_encode(apparent_wind_direction, encodded_apparent_wind_direction);
-        
-        gatts_value.len     = MAX_WIN_DIRECTION_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_apparent_wind_direction;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->awd_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
+        switch (p_desc->length)
         {
-            return err_code;
-        }
-
-        // Send value if connected and notifying.
-        if (p_ess->is_awd_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+            case 1:
+                p_encoded[len] = (uint8_t)p_value[i];
+                break;
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+            case 2:
+                (void)uint16_encode((uint16_t)p_value[i], &p_encoded[len]);
+                break;
 
-            hvx_params.handle = p_ess->awd_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+            case 3:
+                (void)uint24_encode((uint32_t)p_value[i], &p_encoded[len]);
+                break;
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
+            default:
+                (void)uint32_encode((uint32_t)p_value[i], &p_encoded[len]);
+                break;
         }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
+        len += p_desc->length;
     }
 
-    return err_code;
+    return len;
 }
 
 
-ret_code_t ble_ess_apparent_wind_speed_update(ble_ess_t * p_ess,
-                                              uint16_t    apparent_wind_speed)
+/**@brief Function for decoding one component of a characteristic value.
+ *
+ * @param[in]   p_data      Encoded component.
+ * @param[in]   p_desc    Descriptor of the characteristic.  
+ *
+ * @return      Decoded, sign extended component.
+ */
+static int32_t char_component_decode(uint8_t const * p_data, char_desc_t const * p_desc)
 {
-    if (p_ess == NULL)
-    {
-        return NRF_ERROR_NULL;
-    }
-
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    switch (p_desc->length)
     {
-        uint8_t encodded_apparent_wind_speed[MAX_WIN_SPEED_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint16_encode(apparent_wind_speed, encodded_apparent_wind_speed);
-        
-        gatts_value.len     = MAX_WIN_SPEED_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_apparent_wind_speed;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->aws_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-
-        // Send value if connected and notifying.
-        if (p_ess->is_aws_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+        case 1:
+            return p_desc->is_signed ? (int8_t)p_data[0] : p_data[0];
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+        case 2:
+            return p_desc->is_signed ? (int16_t)uint16_decode(p_data) : uint16_decode(p_data);
 
-            hvx_params.handle = p_ess->aws_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+        case 3:
+            return p_desc->is_signed ? ((int32_t)(uint24_decode(p_data) << 8) >> 8)
+                                       : (int32_t)uint24_decode(p_data);
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
+        default:
+            return (int32_t)uint32_decode(p_data);
     }
-
-    return err_code;
 }
 
 
-ret_code_t ble_ess_dew_point_update(ble_ess_t * p_ess,
-                                    int8_t      dew_point)
+/**@brief Function for reading which characteristics have notification enabled on a link.
+ *
+ * @details The CCCD values of a bonded peer are restored by the Peer Manager, so they are read
+ *          back from the attribute table rather than only tracked through write events.
+ *
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   conn_handle Connection handle of the link.
+ * @param[in]   p_client    Context of the link.
+ */
+static void cccd_refresh(ble_ess_t * p_ess, uint16_t conn_handle, ble_ess_client_context_t * p_client)
 {
-    if (p_ess == NULL)
-    {
-        return NRF_ERROR_NULL;
-    }
-
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
+    p_client->notification_enabled = 0;
 
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (uint32_t i = 0; i < BLE_ESS_CHAR_ENABLED_COUNT; i++)
     {
-        uint8_t encodded_dew_point = dew_point;
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-        
-        gatts_value.len     = sizeof(encodded_dew_point);
-        gatts_value.offset  = 0;
-        gatts_value.p_value = &encodded_dew_point;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->dp_handles.value_handle,
-                                          &gatts_value);
+        ble_ess_char_ctx_t * p_char = &p_ess->chars[i];
+        uint8_t              cccd_value[BLE_CCCD_VALUE_LEN];
+        ble_gatts_value_t    gatts_val;
 
-        if (err_code != NRF_SUCCESS)
+        if (!p_char->is_notification_supported)
         {
-            return err_code;
+            continue;
         }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_dp_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
-
-            memset(&hvx_params, 0, sizeof(hvx_params));
+        memset(&gatts_val, 0, sizeof(gatts_val));
 
-            hvx_params.handle = p_ess->dp_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+        gatts_val.p_value = cccd_value;
+        gatts_val.len     = sizeof(cccd_value);
+        gatts_val.offset  = 0;
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
+        if ((sd_ble_gatts_value_get(conn_handle, p_char->handles.cccd_handle, &gatts_val) == NRF_SUCCESS) &&
+            ble_srv_is_notification_enabled(cccd_value))
+        {
+            p_client->notification_enabled |= BLE_ESS_CHAR_BIT(p_char->id);
         }
     }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
-
-    return err_code;
 }
 
 
-ret_code_t ble_ess_elevation_update(ble_ess_t * p_ess,
-                                    int32_t     elevation)
+/**@brief Function for handling the Connect event.
+ *
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_connect(ble_ess_t * p_ess, ble_evt_t const * p_ble_evt)
 {
-    if (p_ess == NULL)
+    ret_code_t                 err_code;
+    ble_ess_client_context_t * p_client = NULL;
+    uint16_t                   conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    uint32_t                   now = app_timer_cnt_get();
+
+    err_code = blcm_link_ctx_get(p_ess->p_link_ctx_storage, conn_handle, (void *) &p_client);
+    if (err_code != NRF_SUCCESS)
     {
-        return NRF_ERROR_NULL;
+        return;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
+    // Conditions are shared, but every characteristic is notified once on a new link.
+    memset(p_client, 0, sizeof(*p_client));
 
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (uint32_t i = 0; i < BLE_ESS_CHAR_ENABLED_COUNT; i++)
     {
-        uint8_t encodded_elevation[MAX_ELEVATION_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint24_encode(elevation, encodded_elevation);
-        
-        gatts_value.len     = MAX_ELEVATION_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_elevation;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->el_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
+        p_client->triggers[i].last_tick = now;
+    }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_el_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+    cccd_refresh(p_ess, conn_handle, p_client);
+}
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
 
-            hvx_params.handle = p_ess->el_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+/**@brief Function for handling the Connection Security Update event.
+ *
+ * @details System attributes of a bonded peer may be applied once the link is encrypted.
+ *
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_conn_sec_update(ble_ess_t * p_ess, ble_evt_t const * p_ble_evt)
+{
+    ble_ess_client_context_t * p_client = NULL;
+    uint16_t                   conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
+    if (blcm_link_ctx_get(p_ess->p_link_ctx_storage, conn_handle, (void *) &p_client) == NRF_SUCCESS)
     {
-        err_code = NRF_ERROR_INVALID_STATE;
+        cccd_refresh(p_ess, conn_handle, p_client);
     }
-
-    return err_code;
 }
 
 
-ret_code_t ble_ess_gust_factor_update(ble_ess_t * p_ess,
-                                      uint8_t     gust_factor)
+/**@brief Function for handling the Write event.
+ *
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_write(ble_ess_t * p_ess, ble_evt_t const * p_ble_evt)
 {
-    if (p_ess == NULL)
+    ble_gatts_evt_write_t const * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+    ble_ess_client_context_t    * p_client    = NULL;
+    ble_ess_evt_t                 evt;
+
+    if ((p_evt_write->len != BLE_CCCD_VALUE_LEN) ||
+        (blcm_link_ctx_get(p_ess->p_link_ctx_storage,
+                           p_ble_evt->evt.gatts_evt.conn_handle,
+                           (void *) &p_client) != NRF_SUCCESS))
     {
-        return NRF_ERROR_NULL;
+        return;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (uint32_t i = 0; i < BLE_ESS_CHAR_ENABLED_COUNT; i++)
     {
-        uint8_t encodded_gust_factor = gust_factor;
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-        
-        gatts_value.len     = sizeof(encodded_gust_factor);
-        gatts_value.offset  = 0;
-        gatts_value.p_value = &encodded_gust_factor;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->gf_handles.value_handle,
-                                          &gatts_value);
+        ble_ess_char_ctx_t * p_char = &p_ess->chars[i];
 
-        if (err_code != NRF_SUCCESS)
+        if (!p_char->is_notification_supported || (p_evt_write->handle != p_char->handles.cccd_handle))
         {
-            return err_code;
+            continue;
         }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_gf_notification_supported)
+        if (ble_srv_is_notification_enabled(p_evt_write->data))
         {
-            ble_gatts_hvx_params_t  hvx_params;
-
-            memset(&hvx_params, 0, sizeof(hvx_params));
-
-            hvx_params.handle = p_ess->gf_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
-
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
+            p_client->notification_enabled |= BLE_ESS_CHAR_BIT(p_char->id);
+            p_client->triggers[i].is_notified = false;
+            evt.evt_type = BLE_ESS_EVT_NOTIFICATION_ENABLED;
         }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
-
-    return err_code;
-}
-
-
-ret_code_t ble_ess_heat_index_update(ble_ess_t * p_ess,
-                                     int8_t      heat_index)
-{
-    if (p_ess == NULL)
-    {
-        return NRF_ERROR_NULL;
-    }
-
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
-    {
-        uint8_t encodded_heat_index = heat_index;
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-        
-        gatts_value.len     = sizeof(encodded_heat_index);
-        gatts_value.offset  = 0;
-        gatts_value.p_value = &encodded_heat_index;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->hi_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
+        else
         {
-            return err_code;
+            p_client->notification_enabled &= ~BLE_ESS_CHAR_BIT(p_char->id);
+            p_client->pending              &= ~BLE_ESS_CHAR_BIT(p_char->id);
+            evt.evt_type = BLE_ESS_EVT_NOTIFICATION_DISABLED;
         }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_hi_notification_supported)
+        if (p_ess->evt_handler != NULL)
         {
-            ble_gatts_hvx_params_t  hvx_params;
-
-            memset(&hvx_params, 0, sizeof(hvx_params));
-
-            hvx_params.handle = p_ess->hi_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
-
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
+            p_ess->evt_handler(p_ess, &evt);
         }
+        break;
     }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
-
-    return err_code;
 }
 
 
-ret_code_t ble_ess_humidity_update(ble_ess_t * p_ess,
-                                   uint16_t    humidity)
+/**@brief Function for applying a write to an ES Trigger Setting descriptor.
+ *
+ * @param[in]   p_char      Characteristic the descriptor belongs to.
+ * @param[in]   p_state     Trigger state of the characteristic on the writing link. Can be NULL.
+ * @param[in]   p_data      Written value: condition followed by its operand.
+ * @param[in]   len         Length of the written value.
+ *
+ * @return      GATT status to reply with.
+ */
+static uint16_t trigger_setting_write(ble_ess_char_ctx_t      * p_char,
+                                      ble_ess_trigger_state_t * p_state,
+                                      uint8_t const           * p_data,
+                                      uint16_t                  len)
 {
-    if (p_ess == NULL)
+    char_desc_t const * p_desc    = &m_char_desc[p_char->id];
+    ble_ess_trigger_t * p_trigger = &p_char->trigger;
+    int32_t             operand   = 0;
+
+    if (len == 0)
     {
-        return NRF_ERROR_NULL;
+        return ESS_ATTERR_WRITE_REQUEST_REJECTED;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    switch (p_data[0])
     {
-        uint8_t encodded_humidity[MAX_HUMIDITY_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint16_encode(humidity, encodded_humidity);
-        
-        gatts_value.len     = MAX_HUMIDITY_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_humidity;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->hum_handles.value_handle,
-                                          &gatts_value);
+        case BLE_ESS_TRIGGER_INACTIVE:
+        case BLE_ESS_TRIGGER_VALUE_CHANGED:
+            if (len != 1)
+            {
+                return ESS_ATTERR_WRITE_REQUEST_REJECTED;
+            }
+            break;
 
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
+        case BLE_ESS_TRIGGER_FIXED_INTERVAL:
+        case BLE_ESS_TRIGGER_MIN_INTERVAL:
+            if (len != 1 + TRIGGER_INTERVAL_LENGTH)
+            {
+                return ESS_ATTERR_WRITE_REQUEST_REJECTED;
+            }
+            operand = (int32_t)uint24_decode(&p_data[1]);
+            break;
 
-        // Send value if connected and notifying.
-        if (p_ess->is_hum_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+        case BLE_ESS_TRIGGER_LESS_THAN:
+        case BLE_ESS_TRIGGER_LESS_OR_EQUAL:
+        case BLE_ESS_TRIGGER_GREATER_THAN:
+        case BLE_ESS_TRIGGER_GREATER_OR_EQUAL:
+        case BLE_ESS_TRIGGER_EQUAL:
+        case BLE_ESS_TRIGGER_NOT_EQUAL:
+            // Thresholds are only defined for scalar characteristics.
+            if (p_desc->components != 1)
+            {
+                return ESS_ATTERR_CONDITION_NOT_SUPPORTED;
+            }
+            if (len != 1 + p_desc->length)
+            {
+                return ESS_ATTERR_WRITE_REQUEST_REJECTED;
+            }
+            operand = char_component_decode(&p_data[1], p_desc);
+            break;
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+        default:
+            return ESS_ATTERR_CONDITION_NOT_SUPPORTED;
+    }
 
-            hvx_params.handle = p_ess->hum_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+    p_trigger->condition = p_data[0];
+    p_trigger->operand   = operand;
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
+    // The writer sees the new condition take effect right away, other links on their next update.
+    if (p_state != NULL)
     {
-        err_code = NRF_ERROR_INVALID_STATE;
+        p_state->is_notified   = false;
+        p_state->elapsed_ticks = 0;
     }
 
-    return err_code;
+    return BLE_GATT_STATUS_SUCCESS;
 }
 
 
-ret_code_t ble_ess_irradiance_update(ble_ess_t * p_ess,
-                                     uint16_t    irradiance)
+/**@brief Function for handling the Read/Write Authorization Request event.
+ *
+ * @details ES Trigger Setting descriptors use deferred writes so that malformed or unsupported
+ *          settings are rejected before they reach the attribute table.
+ *
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_rw_authorize_request(ble_ess_t * p_ess, ble_evt_t const * p_ble_evt)
 {
-    if (p_ess == NULL)
+    ble_gatts_evt_rw_authorize_request_t const * p_req =
+        &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    ble_gatts_rw_authorize_reply_params_t        reply;
+    ble_ess_client_context_t                   * p_client = NULL;
+    ble_ess_trigger_state_t                    * p_state  = NULL;
+    ret_code_t                                   err_code;
+    uint32_t                                     i;
+
+    // Long writes are left to the Queued Write module, the setting always fits in one request.
+    if ((p_req->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE) ||
+        (p_req->request.write.op != BLE_GATTS_OP_WRITE_REQ))
     {
-        return NRF_ERROR_NULL;
+        return;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (i = 0; i < BLE_ESS_CHAR_ENABLED_COUNT; i++)
     {
-        uint8_t encodded_irradiance[MAX_IRRADIANCE_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint16_encode(irradiance, encodded_irradiance);
-        
-        gatts_value.len     = MAX_IRRADIANCE_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_irradiance;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->ird_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-
-        // Send value if connected and notifying.
-        if (p_ess->is_ird_notification_supported)
+        if (p_req->request.write.handle == p_ess->chars[i].trigger.descr_handle)
         {
-            ble_gatts_hvx_params_t  hvx_params;
-
-            memset(&hvx_params, 0, sizeof(hvx_params));
-
-            hvx_params.handle = p_ess->ird_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
-
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
+            break;
         }
     }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
-
-    return err_code;
-}
-
 
-ret_code_t ble_ess_pollen_concentration_update(ble_ess_t * p_ess,
-                                               uint32_t    pollen_concentration)
-{
-    if (p_ess == NULL)
+    if (i == BLE_ESS_CHAR_ENABLED_COUNT)
     {
-        return NRF_ERROR_NULL;
+        return;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    if (blcm_link_ctx_get(p_ess->p_link_ctx_storage,
+                          p_ble_evt->evt.gatts_evt.conn_handle,
+                          (void *) &p_client) == NRF_SUCCESS)
     {
-        uint8_t encodded_pollen_concentration[MAX_POLLEN_CONCENTRATION_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint24_encode(pollen_concentration, encodded_pollen_concentration);
-        
-        gatts_value.len     = MAX_POLLEN_CONCENTRATION_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_pollen_concentration;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->pc_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-
-        // Send value if connected and notifying.
-        if (p_ess->is_pc_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+        p_state = &p_client->triggers[i];
+    }
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+    memset(&reply, 0, sizeof(reply));
 
-            hvx_params.handle = p_ess->pc_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+    reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    reply.params.write.gatt_status = trigger_setting_write(&p_ess->chars[i],
+                                                           p_state,
+                                                           p_req->request.write.data,
+                                                           p_req->request.write.len);
+    reply.params.write.update      = 1;
+    reply.params.write.offset      = p_req->request.write.offset;
+    reply.params.write.len         = p_req->request.write.len;
+    reply.params.write.p_data      = p_req->request.write.data;
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
+    err_code = sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle, &reply);
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_STATE))
     {
-        err_code = NRF_ERROR_INVALID_STATE;
+        APP_ERROR_HANDLER(err_code);
     }
-
-    return err_code;
 }
 
 
-ret_code_t ble_ess_rainfall_update(ble_ess_t * p_ess,
-                                   uint16_t    rainfall)
+/**@brief Function for checking whether a new value has to be notified on a link.
+ *
+ * @param[in]   p_char      Characteristic the value belongs to.
+ * @param[in]   p_state     Trigger state of the characteristic on the link.
+ * @param[in]   p_value     Components of the new value.
+ *
+ * @return      TRUE if the ES Trigger Setting condition of the characteristic is met.
+ */
+static bool trigger_is_fired(ble_ess_char_ctx_t      * p_char,
+                             ble_ess_trigger_state_t * p_state,
+                             int32_t const           * p_value)
 {
-    if (p_ess == NULL)
-    {
-        return NRF_ERROR_NULL;
-    }
+    ble_ess_trigger_t const * p_trigger = &p_char->trigger;
+    uint32_t                  now       = app_timer_cnt_get();
+    uint64_t                  interval  = (uint64_t)p_trigger->operand * TRIGGER_TICKS_PER_SECOND;
+    bool                      changed   = !p_state->is_notified;
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
+    // Accumulate so that intervals longer than one RTC period still work.
+    p_state->elapsed_ticks += app_timer_cnt_diff_compute(now, p_state->last_tick);
+    p_state->last_tick      = now;
 
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (uint32_t i = 0; i < m_char_desc[p_char->id].components; i++)
     {
-        uint8_t encodded_rainfall[MAX_RAINFALL_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint16_encode(rainfall, encodded_rainfall);
-        
-        gatts_value.len     = MAX_RAINFALL_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_rainfall;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->rf_handles.value_handle,
-                                          &gatts_value);
+        int64_t delta = (int64_t)p_value[i] - p_state->last_value[i];
 
-        if (err_code != NRF_SUCCESS)
+        if ((uint64_t)((delta < 0) ? -delta : delta) > p_trigger->deadband)
         {
-            return err_code;
+            changed = true;
         }
+    }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_rf_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+    switch (p_trigger->condition)
+    {
+        case BLE_ESS_TRIGGER_FIXED_INTERVAL:
+            return !p_state->is_notified || (p_state->elapsed_ticks >= interval);
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+        case BLE_ESS_TRIGGER_MIN_INTERVAL:
+            return changed && (!p_state->is_notified || (p_state->elapsed_ticks >= interval));
 
-            hvx_params.handle = p_ess->rf_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+        case BLE_ESS_TRIGGER_VALUE_CHANGED:
+            return changed;
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
+        case BLE_ESS_TRIGGER_LESS_THAN:
+            return p_value[0] < p_trigger->operand;
 
-    return err_code;
-}
+        case BLE_ESS_TRIGGER_LESS_OR_EQUAL:
+            return p_value[0] <= p_trigger->operand;
 
+        case BLE_ESS_TRIGGER_GREATER_THAN:
+            return p_value[0] > p_trigger->operand;
 
-ret_code_t ble_ess_pressure_update(ble_ess_t * p_ess,
-                                   uint32_t    pressure)
-{
-    if (p_ess == NULL)
-    {
-        return NRF_ERROR_NULL;
+        case BLE_ESS_TRIGGER_GREATER_OR_EQUAL:
+            return p_value[0] >= p_trigger->operand;
+
+        case BLE_ESS_TRIGGER_EQUAL:
+            return p_value[0] == p_trigger->operand;
+
+        case BLE_ESS_TRIGGER_NOT_EQUAL:
+            return p_value[0] != p_trigger->operand;
+
+        case BLE_ESS_TRIGGER_INACTIVE:
+        default:
+            return false;
     }
+}
+
 
-    ret_code_t         err_code = NRF_SUCCESS;
+/**@brief Function for writing a value to the attribute table.
+ *
+ * @details The attribute table is shared by all links, so it is written once per update.
+ *
+ * @param[in]   p_char      Characteristic to update.
+ * @param[in]   p_value     Components of the new value.
+ */
+static ret_code_t char_value_set(ble_ess_char_ctx_t * p_char, int32_t const * p_value)
+{
+    ret_code_t         err_code;
+    uint8_t            encoded[MAX_VALUE_LENGTH];
+    uint8_t            previous[MAX_VALUE_LENGTH];
     ble_gatts_value_t  gatts_value;
 
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    memset(&gatts_value, 0, sizeof(gatts_value));
+
+    gatts_value.len     = char_value_encode(p_char->id, p_value, encoded);
+    gatts_value.offset  = 0;
+    gatts_value.p_value = encoded;
+
+    (void)char_value_encode(p_char->id, p_char->value, previous);
+
+    // Only touch the attribute table when the encoded value actually changed.
+    if (memcmp(previous, encoded, gatts_value.len) != 0)
     {
-        uint8_t encodded_pressure[MAX_PRESSURE_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint32_encode(pressure, encodded_pressure);
-        
-        gatts_value.len     = MAX_PRESSURE_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_pressure;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->ps_handles.value_handle,
+        err_code = sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID,
+                                          p_char->handles.value_handle,
                                           &gatts_value);
-
         if (err_code != NRF_SUCCESS)
         {
             return err_code;
         }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_ps_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
-
-            memset(&hvx_params, 0, sizeof(hvx_params));
-
-            hvx_params.handle = p_ess->ps_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
-
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
+        memcpy(p_char->value, p_value, m_char_desc[p_char->id].components * sizeof(int32_t));
     }
 
-    return err_code;
+    return NRF_SUCCESS;
 }
 
 
-ret_code_t ble_ess_temperature_update(ble_ess_t * p_ess,
-                                      int16_t     temperature)
+/**@brief Function for queueing a notification for every pending characteristic of a link.
+ *
+ * @details Once the SoftDevice reports that the notification queue of the link is full, the
+ *          remaining characteristics stay pending until the next flush.
+ *
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   conn_handle Connection handle of the link.
+ * @param[in]   p_client    Context of the link.
+ * @param[out]  p_result    Number of sent and deferred notifications. Can be NULL.
+ */
+static ret_code_t pending_flush(ble_ess_t                * p_ess,
+                                uint16_t                   conn_handle,
+                                ble_ess_client_context_t * p_client,
+                                ble_ess_publish_result_t * p_result)
 {
-    if (p_ess == NULL)
-    {
-        return NRF_ERROR_NULL;
-    }
-
-    ret_code_t              err_code = NRF_SUCCESS;
-    ble_gatts_value_t       gatts_value;
+    ret_code_t err_code;
 
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (uint32_t i = 0; i < BLE_ESS_CHAR_ENABLED_COUNT; i++)
     {
-        uint8_t encodded_temperature[MAX_TEMPERATURE_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint16_encode(temperature, encodded_temperature);
-        
-        gatts_value.len     = MAX_TEMPERATURE_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_temperature;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->tem_handles.value_handle,
-                                          &gatts_value);
+        ble_ess_char_ctx_t      * p_char  = &p_ess->chars[i];
+        ble_ess_trigger_state_t * p_state = &p_client->triggers[i];
+        uint8_t                   encoded[MAX_VALUE_LENGTH];
+        uint16_t                  len;
+        ble_gatts_hvx_params_t    hvx_params;
 
-        if (err_code != NRF_SUCCESS)
+        if ((p_client->pending & BLE_ESS_CHAR_BIT(p_char->id)) == 0)
         {
-            return err_code;
+            continue;
         }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_tem_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+        len = char_value_encode(p_char->id, p_char->value, encoded);
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+        hvx_params.handle = p_char->handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.offset = 0;
+        hvx_params.p_len  = &len;
+        hvx_params.p_data = encoded;
 
-            hvx_params.handle = p_ess->tem_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+        err_code = sd_ble_gatts_hvx(conn_handle, &hvx_params);
+        if (err_code == NRF_SUCCESS)
+        {
+            memcpy(p_state->last_value, p_char->value, sizeof(p_state->last_value));
+            p_state->elapsed_ticks = 0;
+            p_state->is_notified   = true;
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
+            if (p_result != NULL)
+            {
+                p_result->sent++;
+            }
         }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
+        else if (err_code == NRF_ERROR_RESOURCES)
+        {
+            // Count what is left and retry on BLE_GATTS_EVT_HVN_TX_COMPLETE of this link.
+            if (p_result != NULL)
+            {
+                for (; i < BLE_ESS_CHAR_ENABLED_COUNT; i++)
+                {
+                    p_result->deferred += ((p_client->pending & BLE_ESS_CHAR_BIT(p_ess->chars[i].id)) != 0);
+                }
+            }
+            break;
+        }
+        else if ((err_code != NRF_ERROR_INVALID_STATE) &&
+                 (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING))
+        {
+            // Notifications not enabled by the peer are not an error, anything else is.
+            return err_code;
+        }
+
+        p_client->pending &= ~BLE_ESS_CHAR_BIT(p_char->id);
     }
 
-    return err_code;
+    return NRF_SUCCESS;
 }
 
 
-ret_code_t ble_ess_true_wind_direction_update(ble_ess_t * p_ess,
-                                              uint16_t    true_wind_direction)
+/**@brief Function for evaluating the triggers of updated characteristics on one link and
+ *        notifying the ones that fired.
+ *
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   conn_handle Connection handle of the link.
+ * @param[in]   updated     BLE_ESS_CHAR_BIT() of the characteristics that were updated.
+ * @param[out]  p_result    Number of sent and deferred notifications. Can be NULL.
+ */
+static ret_code_t link_notify(ble_ess_t                * p_ess,
+                              uint16_t                   conn_handle,
+                              uint32_t                   updated,
+                              ble_ess_publish_result_t * p_result)
 {
-    if (p_ess == NULL)
+    ret_code_t                 err_code;
+    ble_ess_client_context_t * p_client = NULL;
+
+    err_code = blcm_link_ctx_get(p_ess->p_link_ctx_storage, conn_handle, (void *) &p_client);
+    if (err_code != NRF_SUCCESS)
     {
-        return NRF_ERROR_NULL;
+        return err_code;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (uint32_t i = 0; i < BLE_ESS_CHAR_ENABLED_COUNT; i++)
     {
-        uint8_t encodded_true_wind_direction[MAX_WIN_DIRECTION_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint16_encode(true_wind_direction, encodded_true_wind_direction);
-        
-        gatts_value.len     = MAX_WIN_DIRECTION_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_true_wind_direction;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->twd_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
+        ble_ess_char_ctx_t * p_char = &p_ess->chars[i];
+        uint32_t             bit    = BLE_ESS_CHAR_BIT(p_char->id);
 
-        // Send value if connected and notifying.
-        if (p_ess->is_twd_notification_supported)
+        if (((updated & p_client->notification_enabled & bit) != 0) &&
+            trigger_is_fired(p_char, &p_client->triggers[i], p_char->value))
         {
-            ble_gatts_hvx_params_t  hvx_params;
-
-            memset(&hvx_params, 0, sizeof(hvx_params));
-
-            hvx_params.handle = p_ess->twd_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
-
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
+            p_client->pending |= bit;
         }
     }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
 
-    return err_code;
+    return pending_flush(p_ess, conn_handle, p_client, p_result);
 }
 
 
-ret_code_t ble_ess_true_wind_speed_update(ble_ess_t * p_ess,
-                                          uint16_t    true_wind_speed)
+/**@brief Function for notifying updated characteristics on one link or on all peripheral links.
+ *
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   conn_handle Connection handle of the link, or BLE_CONN_HANDLE_ALL.
+ * @param[in]   updated     BLE_ESS_CHAR_BIT() of the characteristics that were updated.
+ * @param[out]  p_result    Number of sent and deferred notifications. Can be NULL.
+ */
+static ret_code_t links_notify(ble_ess_t                * p_ess,
+                               uint16_t                   conn_handle,
+                               uint32_t                   updated,
+                               ble_ess_publish_result_t * p_result)
 {
-    if (p_ess == NULL)
+    ret_code_t                        err_code;
+    ble_conn_state_conn_handle_list_t conn_handles;
+
+    if (conn_handle != BLE_CONN_HANDLE_ALL)
     {
-        return NRF_ERROR_NULL;
+        return link_notify(p_ess, conn_handle, updated, p_result);
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
+    conn_handles = ble_conn_state_periph_handles();
 
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (uint32_t i = 0; i < conn_handles.len; i++)
     {
-        uint8_t encodded_true_wind_speed[MAX_WIN_SPEED_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint16_encode(true_wind_speed, encodded_true_wind_speed);
-        
-        gatts_value.len     = MAX_HUMIDITY_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_true_wind_speed;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->tws_handles.value_handle,
-                                          &gatts_value);
-
+        err_code = link_notify(p_ess, conn_handles.conn_handles[i], updated, p_result);
         if (err_code != NRF_SUCCESS)
         {
             return err_code;
         }
-
-        // Send value if connected and notifying.
-        if (p_ess->is_tws_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
-
-            memset(&hvx_params, 0, sizeof(hvx_params));
-
-            hvx_params.handle = p_ess->tws_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
-
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
     }
 
-    return err_code;
+    return NRF_SUCCESS;
 }
 
 
-ret_code_t ble_ess_uv_index_update(ble_ess_t * p_ess,
-                                   uint8_t     uv_index)
+/**@brief Function for handling the HVN TX Complete event.
+ *
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_hvn_tx_complete(ble_ess_t * p_ess, ble_evt_t const * p_ble_evt)
 {
-    if (p_ess == NULL)
+    ble_ess_client_context_t * p_client = NULL;
+    uint16_t                   conn_handle = p_ble_evt->evt.gatts_evt.conn_handle;
+
+    if ((blcm_link_ctx_get(p_ess->p_link_ctx_storage, conn_handle, (void *) &p_client) == NRF_SUCCESS) &&
+        (p_client->pending != 0))
     {
-        return NRF_ERROR_NULL;
+        // Queue space was freed on this link, retry its deferred notifications.
+        (void)pending_flush(p_ess, conn_handle, p_client, NULL);
     }
+}
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
 
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+/**@brief Function for reading one snapshot field as characteristic components. */
+static int32_t snapshot_field_get(ble_ess_snapshot_t const * p_snapshot, uint32_t field)
+{
+    switch (field)
     {
-        uint8_t encodded_uv_index = uv_index;
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        gatts_value.len     = sizeof(encodded_uv_index);
-        gatts_value.offset  = 0;
-        gatts_value.p_value = &encodded_uv_index;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->uvi_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
+        case BLE_ESS_SNAPSHOT_EL:
+            return p_snapshot->elevation;
 
-        // Send value if connected and notifying.
-        if (p_ess->is_uvi_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+        case BLE_ESS_SNAPSHOT_HUM:
+            return p_snapshot->humidity;
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+        case BLE_ESS_SNAPSHOT_PS:
+            return (int32_t)p_snapshot->pressure;
 
-            hvx_params.handle = p_ess->uvi_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+        case BLE_ESS_SNAPSHOT_TEM:
+            return p_snapshot->temperature;
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
+        case BLE_ESS_SNAPSHOT_UVI:
+        default:
+            return p_snapshot->uv_index;
     }
-
-    return err_code;
 }
 
 
-ret_code_t ble_ess_wind_chill_update(ble_ess_t * p_ess,
-                                     int8_t      wind_chill)
+void ble_ess_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
 {
-    if (p_ess == NULL)
+    ble_ess_t * p_ess = (ble_ess_t *) p_context;
+    
+    if (p_ess == NULL || p_ble_evt == NULL)
     {
-        return NRF_ERROR_NULL;
+        return;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    switch (p_ble_evt->header.evt_id)
     {
-        uint8_t encodded_wind_chill = wind_chill;
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-        
-        gatts_value.len     = sizeof(encodded_wind_chill);
-        gatts_value.offset  = 0;
-        gatts_value.p_value = &encodded_wind_chill;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->wc_handles.value_handle,
-                                          &gatts_value);
+        case BLE_GAP_EVT_CONNECTED:
+        {
+            on_connect(p_ess, p_ble_evt);
+            break;
+        }
 
-        if (err_code != NRF_SUCCESS)
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:
         {
-            return err_code;
+            on_conn_sec_update(p_ess, p_ble_evt);
+            break;
         }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_wc_notification_supported)
+        case BLE_GATTS_EVT_WRITE:
         {
-            ble_gatts_hvx_params_t  hvx_params;
+            on_write(p_ess, p_ble_evt);
+            break;
+        }
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        {
+            on_rw_authorize_request(p_ess, p_ble_evt);
+            break;
+        }
 
-            hvx_params.handle = p_ess->wc_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        {
+            on_hvn_tx_complete(p_ess, p_ble_evt);
+            break;
+        }
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
+        default:
+        {
+            // No implementation needed.
+            break;
         }
     }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
-    }
+}
 
-    return err_code;
+
+/**@brief Function for adding the ES Trigger Setting descriptor of a characteristic.
+ *
+ * @details This is the only descriptor besides the CCCD. The optional ES Measurement, ES
+ *          Configuration, Valid Range and User Description descriptors are not registered, which
+ *          keeps the attribute table small and service discovery short.
+ *
+ * @param[in]   p_char      Characteristic to add the descriptor to.
+ */
+static ret_code_t trigger_descriptor_add(ble_ess_char_ctx_t * p_char)
+{
+    uint8_t                trigger_setting = BLE_ESS_TRIGGER_VALUE_CHANGED;
+    ble_add_descr_params_t add_char_descriptor_params;
+
+    memset(&add_char_descriptor_params, 0, sizeof(add_char_descriptor_params));
+
+    add_char_descriptor_params.uuid             = 0x290D;
+    add_char_descriptor_params.p_value          = &trigger_setting;
+    add_char_descriptor_params.init_len         = sizeof(trigger_setting);
+    add_char_descriptor_params.max_len          = MAX_TRIGGER_SETTING_LENGTH;
+    add_char_descriptor_params.is_var_len       = true;
+    add_char_descriptor_params.is_defered_write = true;
+    add_char_descriptor_params.read_access      = SEC_OPEN;
+    add_char_descriptor_params.write_access     = SEC_OPEN;
+
+    return descriptor_add(p_char->handles.value_handle,
+                          &add_char_descriptor_params,
+                          &p_char->trigger.descr_handle);
 }
 
 
-ret_code_t ble_ess_barometric_pressure_trend_update(ble_ess_t * p_ess,
-                                                    uint8_t     barometric_pressure_trend)
+ret_code_t ble_ess_init(ble_ess_t * p_ess, const ble_ess_init_t * p_ess_init)
 {
-    if (p_ess == NULL)
+    ret_code_t                  err_code;
+    ble_uuid_t                  ble_uuid;
+    ble_add_char_params_t       add_char_params;
+    uint8_t                     initial_value[MAX_VALUE_LENGTH];
+    uint32_t                    slot = 0;
+
+    if (p_ess == NULL || p_ess_init == NULL)
     {
         return NRF_ERROR_NULL;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
-    {
-        uint8_t encodded_barometric_pressure_trend = barometric_pressure_trend;
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-        
-        gatts_value.len     = sizeof(encodded_barometric_pressure_trend);
-        gatts_value.offset  = 0;
-        gatts_value.p_value = &encodded_barometric_pressure_trend;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->bpt_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
+    // Initialize service structure, the link context storage is bound by BLE_ESS_DEF().
+    memset(p_ess->chars, 0, sizeof(p_ess->chars));
 
-        // Send value if connected and notifying.
-        if (p_ess->is_bpt_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+    p_ess->evt_handler = p_ess_init->evt_handler;
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+    // Add service
+    BLE_UUID_BLE_ASSIGN(ble_uuid, BLE_UUID_ENVIRONMENTAL_SENSING_SERVICE);
 
-            hvx_params.handle = p_ess->bpt_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_ess->service_handle);
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
+    if (err_code != NRF_SUCCESS)
     {
-        err_code = NRF_ERROR_INVALID_STATE;
+        return err_code;
     }
 
-    return err_code;
-}
+    // Add Descriptor Value Changed characteristic
+    memset(&add_char_params, 0, sizeof(add_char_params));
 
+    add_char_params.uuid                  = BLE_UUID_DESCRIPTOR_VALUE_CHANGED;
+    add_char_params.char_props.notify     = p_ess_init->support_dc_notification;
+    add_char_params.char_ext_props.wr_aux = p_ess_init->support_dc_writable_aux;
 
-ret_code_t ble_ess_magnetic_declination_update(ble_ess_t * p_ess,
-                                               uint16_t    magnetic_declination)
-{
-    if (p_ess == NULL)
+    err_code = characteristic_add(p_ess->service_handle,
+                                  &add_char_params,
+                                  &(p_ess->dc_handles));
+    if (err_code != NRF_SUCCESS)
     {
-        return NRF_ERROR_NULL;
+        return err_code;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    // Add the measurement characteristics selected by BLE_ESS_CONFIG_CHAR_MASK
+    for (uint32_t id = 0; id < BLE_ESS_CHAR_COUNT; id++)
     {
-        uint8_t encodded_magnetic_declination[MAX_MAGNETIC_DECLINATION_LENGTH];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-
-        uint16_encode(magnetic_declination, encodded_magnetic_declination);
-        
-        gatts_value.len     = MAX_MAGNETIC_DECLINATION_LENGTH;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_magnetic_declination;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->md_handles.value_handle,
-                                          &gatts_value);
+        ble_ess_char_init_t const * p_init = &p_ess_init->chars[id];
+        ble_ess_char_ctx_t        * p_char = &p_ess->chars[slot];
 
-        if (err_code != NRF_SUCCESS)
+        if (!BLE_ESS_CHAR_IS_ENABLED(id))
         {
-            return err_code;
+            continue;
         }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_md_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
+        p_char->id                          = (ble_ess_char_t)id;
+        p_char->is_notification_supported   = p_init->notification;
+        p_char->trigger.condition           = BLE_ESS_TRIGGER_VALUE_CHANGED;
+        p_char->trigger.deadband            = p_init->deadband;
+        memcpy(p_char->value, p_init->initial_value, sizeof(p_char->value));
+
+        memset(&add_char_params, 0, sizeof(add_char_params));
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+        add_char_params.uuid                  = m_char_desc[id].uuid;
+        add_char_params.max_len               = char_value_encode(p_char->id, p_char->value, initial_value);
+        add_char_params.init_len              = add_char_params.max_len;
+        add_char_params.p_init_value          = initial_value;
+        add_char_params.char_props.read       = 1;
+        add_char_params.char_props.notify     = p_init->notification;
+        add_char_params.char_ext_props.wr_aux = p_init->writable_aux;
+        add_char_params.cccd_write_access     = p_init->cccd_wr_sec;
+        add_char_params.read_access           = p_init->rd_sec;
 
-            hvx_params.handle = p_ess->md_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+        err_code = characteristic_add(p_ess->service_handle,
+                                      &add_char_params,
+                                      &(p_char->handles));
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
+        }
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
+        err_code = trigger_descriptor_add(p_char);
+        if (err_code != NRF_SUCCESS)
+        {
+            return err_code;
         }
-    }
-    else
-    {
-        err_code = NRF_ERROR_INVALID_STATE;
+
+        slot++;
     }
 
-    return err_code;
+    return NRF_SUCCESS;
 }
 
 
-ret_code_t ble_ess_mfd2d_update(ble_ess_t                  * p_ess,
-                                magnetic_flux_density_2d_t   mdf2d)
+ret_code_t ble_ess_char_update(ble_ess_t      * p_ess,
+                               ble_ess_char_t   characteristic,
+                               int32_t const  * p_value,
+                               uint16_t         conn_handle)
 {
-    if (p_ess == NULL)
+    ret_code_t           err_code;
+    ble_ess_char_ctx_t * p_char;
+
+    if (p_ess == NULL || p_value == NULL)
     {
         return NRF_ERROR_NULL;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
-
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    p_char = char_ctx_get(p_ess, characteristic);
+    if (p_char == NULL)
     {
-        uint8_t encodded_mdf2d[MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 2];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-        
-        uint16_encode(mdf2d.magnetic_flux_density_x, &encodded_mdf2d[0]);
-        uint16_encode(mdf2d.magnetic_flux_density_y, &encodded_mdf2d[2]);
-        
-        gatts_value.len     = MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 2;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_mdf2d;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->mfd2d_handles.value_handle,
-                                          &gatts_value);
-
-        if (err_code != NRF_SUCCESS)
-        {
-            return err_code;
-        }
-
-        // Send value if connected and notifying.
-        if (p_ess->is_mfd2d_notification_supported)
-        {
-            ble_gatts_hvx_params_t  hvx_params;
-
-            memset(&hvx_params, 0, sizeof(hvx_params));
-
-            hvx_params.handle = p_ess->mfd2d_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
-
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
+        return NRF_ERROR_NOT_SUPPORTED;
     }
-    else
+
+    err_code = char_value_set(p_char, p_value);
+    if (err_code != NRF_SUCCESS)
     {
-        err_code = NRF_ERROR_INVALID_STATE;
+        return err_code;
     }
 
-    return err_code;
+    return links_notify(p_ess, conn_handle, BLE_ESS_CHAR_BIT(characteristic), NULL);
 }
 
 
-ret_code_t ble_ess_mfd3d_update(ble_ess_t                  * p_ess,
-                                magnetic_flux_density_3d_t   mdf3d)
+ret_code_t ble_ess_snapshot_publish(ble_ess_t                * p_ess,
+                                    ble_ess_snapshot_t const * p_snapshot,
+                                    uint16_t                   conn_handle,
+                                    ble_ess_publish_result_t * p_result)
 {
-    if (p_ess == NULL)
+    ret_code_t               err_code;
+    ble_ess_publish_result_t result;
+    uint32_t                 updated = 0;
+
+    if (p_ess == NULL || p_snapshot == NULL)
     {
         return NRF_ERROR_NULL;
     }
 
-    ret_code_t         err_code = NRF_SUCCESS;
-    ble_gatts_value_t  gatts_value;
+    memset(&result, 0, sizeof(result));
 
-    if (p_ess->conn_handle != BLE_CONN_HANDLE_INVALID)
+    for (uint32_t i = 0; i < BLE_ESS_SNAPSHOT_COUNT; i++)
     {
-        uint8_t encodded_mdf3d[MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 3];
-
-        // Initialize value struct.
-        memset(&gatts_value, 0, sizeof(gatts_value));
-        
-        uint16_encode(mdf3d.magnetic_flux_density_x, &encodded_mdf3d[0]);
-        uint16_encode(mdf3d.magnetic_flux_density_y, &encodded_mdf3d[2]);
-        uint16_encode(mdf3d.magnetic_flux_density_z, &encodded_mdf3d[4]);
-        
-        gatts_value.len     = MAX_MAGNETIC_FLUX_DENSITY_LENGTH * 3;
-        gatts_value.offset  = 0;
-        gatts_value.p_value = encodded_mdf3d;
-        
-        // Update database.
-        err_code = sd_ble_gatts_value_set(p_ess->conn_handle,
-                                          p_ess->mfd3d_handles.value_handle,
-                                          &gatts_value);
+        ble_ess_char_ctx_t * p_char = char_ctx_get(p_ess, m_snapshot_char[i]);
+        int32_t              value;
 
-        if (err_code != NRF_SUCCESS)
+        // Fields of characteristics that are not built in are ignored.
+        if (((p_snapshot->fields & (1UL << i)) == 0) || (p_char == NULL))
         {
-            return err_code;
+            continue;
         }
 
-        // Send value if connected and notifying.
-        if (p_ess->is_mfd3d_notification_supported)
+        value    = snapshot_field_get(p_snapshot, 1UL << i);
+        err_code = char_value_set(p_char, &value);
+        if (err_code != NRF_SUCCESS)
         {
-            ble_gatts_hvx_params_t  hvx_params;
+            return err_code;
+        }
 
-            memset(&hvx_params, 0, sizeof(hvx_params));
+        updated |= BLE_ESS_CHAR_BIT(p_char->id);
+    }
 
-            hvx_params.handle = p_ess->mfd3d_handles.value_handle;
-            hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-            hvx_params.offset = gatts_value.offset;
-            hvx_params.p_len  = &gatts_value.len;
-            hvx_params.p_data = gatts_value.p_value;
+    err_code = links_notify(p_ess, conn_handle, updated, &result);
 
-            err_code = sd_ble_gatts_hvx(p_ess->conn_handle, &hvx_params);
-        }
-    }
-    else
+    if (p_result != NULL)
     {
-        err_code = NRF_ERROR_INVALID_STATE;
+        *p_result = result;
     }
 
     return err_code;
-}
\ No newline at end of file
+}
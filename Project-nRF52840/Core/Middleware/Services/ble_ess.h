@@ -3,9 +3,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "sdk_config.h"
 #include "ble.h"
 #include "ble_srv_common.h"
 #include "nrf_sdh_ble.h"
+#include "ble_link_ctx_manager.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,14 +41,21 @@ extern "C" {
 
 /**@brief Macro for defining a ble_env instance.
  *
- * @param   _name  Name of the instance.
+ * @param   _name               Name of the instance.
+ * @param   _ess_max_clients    Maximum number of ESS clients connected at a time.
  * @hideinitializer
  */
-#define BLE_ESS_DEF(_name)                          \
-    static ble_ess_t _name;                         \
-    NRF_SDH_BLE_OBSERVER(_name ## _obs,             \
-                         BLE_ESS_BLE_OBSERVER_PRIO, \
-                         ble_ess_on_ble_evt,        \
+#define BLE_ESS_DEF(_name, _ess_max_clients)                      \
+    BLE_LINK_CTX_MANAGER_DEF(CONCAT_2(_name, _link_ctx_storage),  \
+                             (_ess_max_clients),                  \
+                             sizeof(ble_ess_client_context_t));   \
+    static ble_ess_t _name =                                      \
+    {                                                             \
+        .p_link_ctx_storage = &CONCAT_2(_name, _link_ctx_storage) \
+    };                                                            \
+    NRF_SDH_BLE_OBSERVER(_name ## _obs,                           \
+                         BLE_ESS_BLE_OBSERVER_PRIO,               \
+                         ble_ess_on_ble_evt,                      \
                          &_name)
 
 /**@brief Environmental Sensing Service event type. */
@@ -62,18 +71,161 @@ typedef struct
     ble_ess_evt_type_t evt_type;    /**< Type of event. */
 } ble_ess_evt_t;
 
+/**@brief Environmental Sensing characteristics that carry a measurement. */
+typedef enum
+{
+    BLE_ESS_CHAR_AWD,                   /**< Apparent Wind Direction. */
+    BLE_ESS_CHAR_AWS,                   /**< Apparent Wind Speed. */
+    BLE_ESS_CHAR_DP,                    /**< Dew Point. */
+    BLE_ESS_CHAR_EL,                    /**< Elevation. */
+    BLE_ESS_CHAR_GF,                    /**< Gust Factor. */
+    BLE_ESS_CHAR_HI,                    /**< Heat Index. */
+    BLE_ESS_CHAR_HUM,                   /**< Humidity. */
+    BLE_ESS_CHAR_IRD,                   /**< Irradiance. */
+    BLE_ESS_CHAR_PC,                    /**< Pollen Concentration. */
+    BLE_ESS_CHAR_RF,                    /**< Rainfall. */
+    BLE_ESS_CHAR_PS,                    /**< Pressure. */
+    BLE_ESS_CHAR_TEM,                   /**< Temperature. */
+    BLE_ESS_CHAR_TWD,                   /**< True Wind Direction. */
+    BLE_ESS_CHAR_TWS,                   /**< True Wind Speed. */
+    BLE_ESS_CHAR_UVI,                   /**< UV Index. */
+    BLE_ESS_CHAR_WC,                    /**< Wind Chill. */
+    BLE_ESS_CHAR_BPT,                   /**< Barometric Pressure Trend. */
+    BLE_ESS_CHAR_MD,                    /**< Magnetic Declination. */
+    BLE_ESS_CHAR_MFD2D,                 /**< Magnetic Flux Density - 2D. */
+    BLE_ESS_CHAR_MFD3D,                 /**< Magnetic Flux Density - 3D. */
+    BLE_ESS_CHAR_COUNT
+} ble_ess_char_t;
+
+/**@brief ES Trigger Setting conditions (Environmental Sensing Service, section 3.1.2.2). */
+typedef enum
+{
+    BLE_ESS_TRIGGER_INACTIVE            = 0x00, /**< Trigger inactive, no notifications. */
+    BLE_ESS_TRIGGER_FIXED_INTERVAL      = 0x01, /**< Fixed time interval between notifications, operand in seconds. */
+    BLE_ESS_TRIGGER_MIN_INTERVAL        = 0x02, /**< Changed values, no less than the operand in seconds apart. */
+    BLE_ESS_TRIGGER_VALUE_CHANGED       = 0x03, /**< Value changed by more than the deadband. */
+    BLE_ESS_TRIGGER_LESS_THAN           = 0x04, /**< While less than the operand. */
+    BLE_ESS_TRIGGER_LESS_OR_EQUAL       = 0x05, /**< While less than or equal to the operand. */
+    BLE_ESS_TRIGGER_GREATER_THAN        = 0x06, /**< While greater than the operand. */
+    BLE_ESS_TRIGGER_GREATER_OR_EQUAL    = 0x07, /**< While greater than or equal to the operand. */
+    BLE_ESS_TRIGGER_EQUAL               = 0x08, /**< While equal to the operand. */
+    BLE_ESS_TRIGGER_NOT_EQUAL           = 0x09  /**< While not equal to the operand. */
+} ble_ess_trigger_condition_t;
+
+#define BLE_ESS_CHAR_BIT(_char)                     (1UL << (_char))
+
+#define BLE_ESS_CHAR_SELECT(_name)                                                          \
+    ((BLE_ESS_CONFIG_ ## _name ## _ENABLED) ? BLE_ESS_CHAR_BIT(BLE_ESS_CHAR_ ## _name) : 0)
+
+/**@brief Characteristics built into the service, a combination of BLE_ESS_CHAR_BIT() values.
+ *        Characteristics outside the mask cost neither RAM nor attribute table space.
+ *        By default the mask follows the BLE_ESS_CONFIG_*_ENABLED options in sdk_config.h. */
+#ifndef BLE_ESS_CONFIG_CHAR_MASK
+#ifdef BLE_ESS_CONFIG_EL_ENABLED
+#define BLE_ESS_CONFIG_CHAR_MASK                                                            \
+    (BLE_ESS_CHAR_SELECT(AWD)   | BLE_ESS_CHAR_SELECT(AWS)   | BLE_ESS_CHAR_SELECT(DP)    | \
+     BLE_ESS_CHAR_SELECT(EL)    | BLE_ESS_CHAR_SELECT(GF)    | BLE_ESS_CHAR_SELECT(HI)    | \
+     BLE_ESS_CHAR_SELECT(HUM)   | BLE_ESS_CHAR_SELECT(IRD)   | BLE_ESS_CHAR_SELECT(PC)    | \
+     BLE_ESS_CHAR_SELECT(RF)    | BLE_ESS_CHAR_SELECT(PS)    | BLE_ESS_CHAR_SELECT(TEM)   | \
+     BLE_ESS_CHAR_SELECT(TWD)   | BLE_ESS_CHAR_SELECT(TWS)   | BLE_ESS_CHAR_SELECT(UVI)   | \
+     BLE_ESS_CHAR_SELECT(WC)    | BLE_ESS_CHAR_SELECT(BPT)   | BLE_ESS_CHAR_SELECT(MD)    | \
+     BLE_ESS_CHAR_SELECT(MFD2D) | BLE_ESS_CHAR_SELECT(MFD3D))
+#else
+#define BLE_ESS_CONFIG_CHAR_MASK                    (BLE_ESS_CHAR_BIT(BLE_ESS_CHAR_COUNT) - 1)
+#endif
+#endif
+
+#define BLE_ESS_CHAR_IS_ENABLED(_char)              ((BLE_ESS_CONFIG_CHAR_MASK & BLE_ESS_CHAR_BIT(_char)) != 0)
+
+/**@brief Number of bits set in the low 20 bits of _mask. */
+#define BLE_ESS_BIT_COUNT(_mask)                                                            \
+    ((((_mask) >>  0) & 1) + (((_mask) >>  1) & 1) + (((_mask) >>  2) & 1) +                \
+     (((_mask) >>  3) & 1) + (((_mask) >>  4) & 1) + (((_mask) >>  5) & 1) +                \
+     (((_mask) >>  6) & 1) + (((_mask) >>  7) & 1) + (((_mask) >>  8) & 1) +                \
+     (((_mask) >>  9) & 1) + (((_mask) >> 10) & 1) + (((_mask) >> 11) & 1) +                \
+     (((_mask) >> 12) & 1) + (((_mask) >> 13) & 1) + (((_mask) >> 14) & 1) +                \
+     (((_mask) >> 15) & 1) + (((_mask) >> 16) & 1) + (((_mask) >> 17) & 1) +                \
+     (((_mask) >> 18) & 1) + (((_mask) >> 19) & 1))
+
+#define BLE_ESS_CHAR_ENABLED_COUNT                  BLE_ESS_BIT_COUNT(BLE_ESS_CONFIG_CHAR_MASK)
+
+#define BLE_ESS_MAX_COMPONENTS                      3   /**< Largest number of components in one value (Magnetic Flux Density - 3D). */
+
+/**@brief Notification trigger of one characteristic, shared by all links. */
+typedef struct
+{
+    uint16_t    descr_handle;           /**< Handle of the ES Trigger Setting descriptor. */
+    uint8_t     condition;              /**< Active condition, see @ref ble_ess_trigger_condition_t. */
+    int32_t     operand;                /**< Interval in seconds, or threshold in characteristic units. */
+    uint32_t    deadband;               /**< Largest change, in characteristic units, that is not notified. */
+} ble_ess_trigger_t;
+
+/**@brief Notification trigger state of one characteristic on one link. */
+typedef struct
+{
+    int32_t     last_value[BLE_ESS_MAX_COMPONENTS]; /**< Components of the last value notified on the link. */
+    uint64_t    elapsed_ticks;          /**< RTC ticks since the last notification on the link. */
+    uint32_t    last_tick;              /**< RTC counter at the last evaluation. */
+    bool        is_notified;            /**< TRUE once a value has been notified on the link. */
+} ble_ess_trigger_state_t;
+
+/**@brief Environmental Sensing Service client context structure.
+ *
+ * @details This structure contains state context related to hosts.
+ */
 typedef struct
 {
-    int16_t magnetic_flux_density_x;
-    int16_t magnetic_flux_density_y;
-} magnetic_flux_density_2d_t;
+    uint32_t                notification_enabled;                       /**< BLE_ESS_CHAR_BIT() of characteristics whose CCCD enables notification on the link. */
+    uint32_t                pending;                                    /**< BLE_ESS_CHAR_BIT() of characteristics whose trigger fired but are not notified yet. */
+    ble_ess_trigger_state_t triggers[BLE_ESS_CHAR_ENABLED_COUNT];       /**< Trigger state of each built-in characteristic, in @ref ble_ess_char_t order. */
+} ble_ess_client_context_t;
 
+/**@brief Runtime state of one built-in characteristic. */
+typedef struct
+{
+    ble_ess_char_t              id;                             /**< Which characteristic this is. */
+    bool                        is_notification_supported;      /**< TRUE if notification is supported. */
+    ble_gatts_char_handles_t    handles;                        /**< Handles of the characteristic. */
+    int32_t                     value[BLE_ESS_MAX_COMPONENTS];  /**< Components of the value in the attribute table. */
+    ble_ess_trigger_t           trigger;                        /**< Notification trigger. */
+} ble_ess_char_ctx_t;
+
+/**@brief Application settings of one characteristic. */
+typedef struct
+{
+    bool            notification;                           /**< TRUE if notification is supported. */
+    bool            writable_aux;                           /**< TRUE if writable auxiliaries are supported. */
+    security_req_t  rd_sec;                                 /**< Security requirement for reading the characteristic value. */
+    security_req_t  cccd_wr_sec;                            /**< Security requirement for writing the characteristic CCCD. */
+    int32_t         initial_value[BLE_ESS_MAX_COMPONENTS];  /**< Initial value, one entry per component. */
+    uint32_t        deadband;                               /**< Deadband of the value changed trigger, in characteristic units. */
+} ble_ess_char_init_t;
+
+/**@brief Snapshot field flags, one per characteristic that can be published in a batch. */
+#define BLE_ESS_SNAPSHOT_EL                         (1UL << 0)  /**< Elevation field is valid. */
+#define BLE_ESS_SNAPSHOT_HUM                        (1UL << 1)  /**< Humidity field is valid. */
+#define BLE_ESS_SNAPSHOT_PS                         (1UL << 2)  /**< Pressure field is valid. */
+#define BLE_ESS_SNAPSHOT_TEM                        (1UL << 3)  /**< Temperature field is valid. */
+#define BLE_ESS_SNAPSHOT_UVI                        (1UL << 4)  /**< UV Index field is valid. */
+#define BLE_ESS_SNAPSHOT_COUNT                      5
+
+/**@brief Set of sensor values published together by @ref ble_ess_snapshot_publish. */
+typedef struct
+{
+    uint32_t    fields;                 /**< Combination of BLE_ESS_SNAPSHOT_* flags telling which values are valid. */
+    int32_t     elevation;              /**< Elevation, 0.01 m. */
+    uint16_t    humidity;               /**< Humidity, 0.01 %. */
+    uint32_t    pressure;               /**< Pressure, 0.1 Pa. */
+    int16_t     temperature;            /**< Temperature, 0.01 degree Celsius. */
+    uint8_t     uv_index;               /**< UV Index. */
+} ble_ess_snapshot_t;
+
+/**@brief Outcome of a batched publish. */
 typedef struct
 {
-    int16_t magnetic_flux_density_x;
-    int16_t magnetic_flux_density_y;
-    int16_t magnetic_flux_density_z;
-} magnetic_flux_density_3d_t;
+    uint8_t     sent;                   /**< Notifications queued in the SoftDevice. */
+    uint8_t     deferred;               /**< Notifications that did not fit in the queue, retried on TX complete. */
+} ble_ess_publish_result_t;
 
 // Forward declaration of the ble_ess_t type.
 typedef struct ble_ess_s ble_ess_t;
@@ -85,183 +237,21 @@ typedef void (*ble_ess_evt_handler_t) (ble_ess_t * p_ess, ble_ess_evt_t * p_evt)
  *        initialization of the service.*/
 typedef struct
 {
-    ble_ess_evt_handler_t   evt_handler;                    /**< Event handler to be called for handling events in the Battery Service.       */
+    ble_ess_evt_handler_t   evt_handler;                    /**< Event handler to be called for handling events in the Environmental Sensing Service. */
     bool                    support_dc_notification;        /**< TRUE if notification of Descriptor Value Changed is supported.               */
     bool                    support_dc_writable_aux;        /**< TRUE if writable auxiliaries of Descriptor Value Changed is supported.       */
-    bool                    support_awd_notification;       /**< TRUE if notification of Apparent Wind Direction is supported.                */
-    bool                    support_awd_writable_aux;       /**< TRUE if writable auxiliaries of Apparent Wind Direction is supported.        */
-    bool                    support_aws_notification;       /**< TRUE if notification of Apparent Wind Speed is supported.                    */
-    bool                    support_aws_writable_aux;       /**< TRUE if writable auxiliaries of Apparent Wind Speed is supported.            */
-    bool                    support_dp_notification;        /**< TRUE if notification of Dew Point is supported.                              */
-    bool                    support_dp_writable_aux;        /**< TRUE if writable auxiliaries of Dew Point is supported.                      */
-    bool                    support_el_notification;        /**< TRUE if notification of Elevation is supported.                              */
-    bool                    support_el_writable_aux;        /**< TRUE if writable auxiliaries of Elevation is supported.                      */
-    bool                    support_gf_notification;        /**< TRUE if notification of Gust Factor is supported.                            */
-    bool                    support_gf_writable_aux;        /**< TRUE if writable auxiliaries of Gust Factor is supported.                    */
-    bool                    support_hi_notification;        /**< TRUE if notification of Heat Index is supported.                             */
-    bool                    support_hi_writable_aux;        /**< TRUE if writable auxiliaries of Heat Index is supported.                     */
-    bool                    support_hum_notification;       /**< TRUE if notification of Humidity is supported.                               */
-    bool                    support_hum_writable_aux;       /**< TRUE if writable auxiliaries of Humidity is supported.                       */
-    bool                    support_ird_notification;       /**< TRUE if notification of Irradiance is supported.                             */
-    bool                    support_ird_writable_aux;       /**< TRUE if writable auxiliaries of Irradiance is supported.                     */
-    bool                    support_pc_notification;        /**< TRUE if notification of Pollen Concentration is supported.                   */
-    bool                    support_pc_writable_aux;        /**< TRUE if writable auxiliaries of Pollen Concentration is supported.           */
-    bool                    support_rf_notification;        /**< TRUE if notification of Rainfall is supported.                               */
-    bool                    support_rf_writable_aux;        /**< TRUE if writable auxiliaries of Rainfall is supported.                       */
-    bool                    support_ps_notification;        /**< TRUE if notification of Pressure is supported.                               */
-    bool                    support_ps_writable_aux;        /**< TRUE if writable auxiliaries of Pressure is supported.                       */
-    bool                    support_tem_notification;       /**< TRUE if notification of Temperature is supported.                            */
-    bool                    support_tem_writable_aux;       /**< TRUE if writable auxiliaries of Temperature is supported.                    */
-    bool                    support_twd_notification;       /**< TRUE if notification of True Wind Direction is supported.                    */
-    bool                    support_twd_writable_aux;       /**< TRUE if writable auxiliaries of True Wind Direction is supported.            */
-    bool                    support_tws_notification;       /**< TRUE if notification of True Wind Speed is supported.                        */
-    bool                    support_tws_writable_aux;       /**< TRUE if writable auxiliaries of True Wind Speed is supported.                */
-    bool                    support_uvi_notification;       /**< TRUE if notification of UV Index is supported.                               */
-    bool                    support_uvi_writable_aux;       /**< TRUE if writable auxiliaries of UV Index is supported.                       */
-    bool                    support_wc_notification;        /**< TRUE if notification of Wind Chill is supported.                             */
-    bool                    support_wc_writable_aux;        /**< TRUE if writable auxiliaries of Wind Chill is supported.                     */
-    bool                    support_bpt_notification;       /**< TRUE if notification of Barometric Pressure Trend is supported.              */
-    bool                    support_bpt_writable_aux;       /**< TRUE if writable auxiliaries of Barometric Pressure Trend is supported.      */
-    bool                    support_md_notification;        /**< TRUE if notification of Magnetic Declination is supported.                   */
-    bool                    support_md_writable_aux;        /**< TRUE if writable auxiliaries of Magnetic Declination is supported.           */
-    bool                    support_mfd2d_notification;     /**< TRUE if notification of Magnetic Flux Density - 2D is supported.             */
-    bool                    support_mfd2d_writable_aux;     /**< TRUE if writable auxiliaries of Magnetic Flux Density - 2D is supported.     */
-    bool                    support_mfd3d_notification;     /**< TRUE if notification of Magnetic Flux Density - 3D is supported.             */
-    bool                    support_mfd3d_writable_aux;     /**< TRUE if writable auxiliaries of Magnetic Flux Density - 3D is supported.     */
-
-    int8_t                      initial_dew_point;
-    int8_t                      initial_heat_index;
-    int8_t                      initial_wind_chill;
-    uint8_t                     initial_gust_factor;
-    uint8_t                     initial_uv_index;
-    uint8_t                     initial_barometric_pressure_trend;
-    int16_t                     initial_temperature;
-    magnetic_flux_density_2d_t  initial_magnetic_flux_density_2d;
-    magnetic_flux_density_3d_t  initial_magnetic_flux_density_3d;
-    uint16_t                    initial_apparent_wind_direction;
-    uint16_t                    initial_apparent_wind_speed;
-    uint16_t                    initial_humidity;
-    uint16_t                    initial_irradiance;
-    uint16_t                    initial_true_wind_direction;
-    uint16_t                    initial_true_wind_speed;
-    uint16_t                    initial_rainfall;
-    uint16_t                    initial_magnetic_declination;
-    int32_t                     initial_elevation;
-    uint32_t                    initial_pollen_concentration;
-    uint32_t                    initial_pressure; 
-
-    security_req_t          awd_rd_sec;                 /**< Security requirement for reading the AWD characteristic value.   */
-    security_req_t          awd_cccd_wr_sec;            /**< Security requirement for writing the AWD characteristic CCCD.    */
-    security_req_t          aws_rd_sec;                 /**< Security requirement for reading the AWS characteristic value.   */
-    security_req_t          aws_cccd_wr_sec;            /**< Security requirement for writing the AWS characteristic CCCD.    */
-    security_req_t          dp_rd_sec;                  /**< Security requirement for reading the DP characteristic value.    */
-    security_req_t          dp_cccd_wr_sec;             /**< Security requirement for writing the DP characteristic CCCD.     */
-    security_req_t          el_rd_sec;                  /**< Security requirement for reading the EL characteristic value.    */
-    security_req_t          el_cccd_wr_sec;             /**< Security requirement for writing the EL characteristic CCCD.     */
-    security_req_t          gf_rd_sec;                  /**< Security requirement for reading the GF characteristic value.    */
-    security_req_t          gf_cccd_wr_sec;             /**< Security requirement for writing the GF characteristic CCCD.     */
-    security_req_t          hi_rd_sec;                  /**< Security requirement for reading the HI characteristic value.    */
-    security_req_t          hi_cccd_wr_sec;             /**< Security requirement for writing the HI characteristic CCCD.     */
-    security_req_t          hum_rd_sec;                 /**< Security requirement for reading the HUM characteristic value.   */
-    security_req_t          hum_cccd_wr_sec;            /**< Security requirement for writing the HUM characteristic CCCD.    */
-    security_req_t          ird_rd_sec;                 /**< Security requirement for reading the IRD characteristic value.   */
-    security_req_t          ird_cccd_wr_sec;            /**< Security requirement for writing the IRD characteristic CCCD.    */
-    security_req_t          pc_rd_sec;                  /**< Security requirement for reading the PC characteristic value.    */
-    security_req_t          pc_cccd_wr_sec;             /**< Security requirement for writing the PC characteristic CCCD.     */
-    security_req_t          rf_rd_sec;                  /**< Security requirement for reading the RF characteristic value.    */
-    security_req_t          rf_cccd_wr_sec;             /**< Security requirement for writing the RF characteristic CCCD.     */
-    security_req_t          ps_rd_sec;                  /**< Security requirement for reading the PS characteristic value.    */
-    security_req_t          ps_cccd_wr_sec;             /**< Security requirement for writing the PS characteristic CCCD.     */
-    security_req_t          tem_rd_sec;                 /**< Security requirement for reading the TEM characteristic value.   */
-    security_req_t          tem_cccd_wr_sec;            /**< Security requirement for writing the TEM characteristic CCCD.    */
-    security_req_t          twd_rd_sec;                 /**< Security requirement for reading the TWD characteristic value.   */
-    security_req_t          twd_cccd_wr_sec;            /**< Security requirement for writing the TWD characteristic CCCD.    */
-    security_req_t          tws_rd_sec;                 /**< Security requirement for reading the TWS characteristic value.   */
-    security_req_t          tws_cccd_wr_sec;            /**< Security requirement for writing the TWS characteristic CCCD.    */
-    security_req_t          uvi_rd_sec;                 /**< Security requirement for reading the UVI characteristic value.   */
-    security_req_t          uvi_cccd_wr_sec;            /**< Security requirement for writing the UVI characteristic CCCD.    */
-    security_req_t          wc_rd_sec;                  /**< Security requirement for reading the WC characteristic value.    */
-    security_req_t          wc_cccd_wr_sec;             /**< Security requirement for writing the WC characteristic CCCD.     */
-    security_req_t          bpt_rd_sec;                 /**< Security requirement for reading the BPT characteristic value.   */
-    security_req_t          bpt_cccd_wr_sec;            /**< Security requirement for writing the BPT characteristic CCCD.    */
-    security_req_t          md_rd_sec;                  /**< Security requirement for reading the MD characteristic value.    */
-    security_req_t          md_cccd_wr_sec;             /**< Security requirement for writing the MD characteristic CCCD.     */
-    security_req_t          mfd2d_rd_sec;               /**< Security requirement for reading the MFD2D characteristic value. */
-    security_req_t          mfd2d_cccd_wr_sec;          /**< Security requirement for writing the MFD2D characteristic CCCD.  */
-    security_req_t          mfd3d_rd_sec;               /**< Security requirement for reading the MFD3D characteristic value. */
-    security_req_t          mfd3d_cccd_wr_sec;          /**< Security requirement for writing the MFD3D characteristic CCCD.  */
+    ble_ess_char_init_t     chars[BLE_ESS_CHAR_COUNT];      /**< Settings of each characteristic, indexed by @ref ble_ess_char_t. Entries outside BLE_ESS_CONFIG_CHAR_MASK are ignored. */
 } ble_ess_init_t;
 
 
 /**@brief Environmental Sensing Service structure. This contains various status information for the service. */
 struct ble_ess_s
 {
-    ble_ess_evt_handler_t     evt_handler;                      /**< Event handler to be called for handling events in the Battery Service.       */
-    bool                      is_dc_notification_supported;     /**< TRUE if notification of Descriptor Value Changed is supported.               */
-    bool                      is_dc_writable_aux_supported;     /**< TRUE if writable auxiliaries of Descriptor Value Changed is supported.       */
-    bool                      is_awd_notification_supported;    /**< TRUE if notification of Apparent Wind Direction is supported.                */
-    bool                      is_awd_writable_aux_supported;    /**< TRUE if writable auxiliaries of Apparent Wind Direction is supported.        */
-    bool                      is_aws_notification_supported;    /**< TRUE if notification of Apparent Wind Speed is supported.                    */
-    bool                      is_aws_writable_aux_supported;    /**< TRUE if writable auxiliaries of Apparent Wind Speed is supported.            */
-    bool                      is_dp_notification_supported;     /**< TRUE if notification of Dew Point is supported.                              */
-    bool                      is_dp_writable_aux_supported;     /**< TRUE if writable auxiliaries of Dew Point is supported.                      */
-    bool                      is_el_notification_supported;     /**< TRUE if notification of Elevation is supported.                              */
-    bool                      is_el_writable_aux_supported;     /**< TRUE if writable auxiliaries of Elevation is supported.                      */
-    bool                      is_gf_notification_supported;     /**< TRUE if notification of Gust Factor is supported.                            */
-    bool                      is_gf_writable_aux_supported;     /**< TRUE if writable auxiliaries of Gust Factor is supported.                    */
-    bool                      is_hi_notification_supported;     /**< TRUE if notification of Heat Index is supported.                             */
-    bool                      is_hi_writable_aux_supported;     /**< TRUE if writable auxiliaries of Heat Index is supported.                     */
-    bool                      is_hum_notification_supported;    /**< TRUE if notification of Humidity is supported.                               */
-    bool                      is_hum_writable_aux_supported;    /**< TRUE if writable auxiliaries of Humidity is supported.                       */
-    bool                      is_ird_notification_supported;    /**< TRUE if notification of Irradiance is supported.                             */
-    bool                      is_ird_writable_aux_supported;    /**< TRUE if writable auxiliaries of Irradiance is supported.                     */
-    bool                      is_pc_notification_supported;     /**< TRUE if notification of Pollen Concentration is supported.                   */
-    bool                      is_pc_writable_aux_supported;     /**< TRUE if writable auxiliaries of Pollen Concentration is supported.           */
-    bool                      is_rf_notification_supported;     /**< TRUE if notification of Rainfall is supported.                               */
-    bool                      is_rf_writable_aux_supported;     /**< TRUE if writable auxiliaries of Rainfall is supported.                       */
-    bool                      is_ps_notification_supported;     /**< TRUE if notification of Pressure is supported.                               */
-    bool                      is_ps_writable_aux_supported;     /**< TRUE if writable auxiliaries of Pressure is supported.                       */
-    bool                      is_tem_notification_supported;    /**< TRUE if notification of Temperature is supported.                            */
-    bool                      is_tem_writable_aux_supported;    /**< TRUE if writable auxiliaries of Temperature is supported.                    */
-    bool                      is_twd_notification_supported;    /**< TRUE if notification of True Wind Direction is supported.                    */
-    bool                      is_twd_writable_aux_supported;    /**< TRUE if writable auxiliaries of True Wind Direction is supported.            */
-    bool                      is_tws_notification_supported;    /**< TRUE if notification of True Wind Speed is supported.                        */
-    bool                      is_tws_writable_aux_supported;    /**< TRUE if writable auxiliaries of True Wind Speed is supported.                */
-    bool                      is_uvi_notification_supported;    /**< TRUE if notification of UV Index is supported.                               */
-    bool                      is_uvi_writable_aux_supported;    /**< TRUE if writable auxiliaries of UV Index is supported.                       */
-    bool                      is_wc_notification_supported;     /**< TRUE if notification of Wind Chill is supported.                             */
-    bool                      is_wc_writable_aux_supported;     /**< TRUE if writable auxiliaries of Wind Chill is supported.                     */
-    bool                      is_bpt_notification_supported;    /**< TRUE if notification of Barometric Pressure Trend is supported.              */
-    bool                      is_bpt_writable_aux_supported;    /**< TRUE if writable auxiliaries of Barometric Pressure Trend is supported.      */
-    bool                      is_md_notification_supported;     /**< TRUE if notification of Magnetic Declination is supported.                   */
-    bool                      is_md_writable_aux_supported;     /**< TRUE if writable auxiliaries of Magnetic Declination is supported.           */
-    bool                      is_mfd2d_notification_supported;  /**< TRUE if notification of Magnetic Flux Density - 2D is supported.             */
-    bool                      is_mfd2d_writable_aux_supported;  /**< TRUE if writable auxiliaries of Magnetic Flux Density - 2D is supported.     */
-    bool                      is_mfd3d_notification_supported;  /**< TRUE if notification of Magnetic Flux Density - 3D is supported.             */
-    bool                      is_mfd3d_writable_aux_supported;  /**< TRUE if writable auxiliaries of Magnetic Flux Density - 3D is supported.     */
-    uint16_t                  service_handle;                   /**< Handle of Battery Service (as provided by the BLE stack). */
-    uint16_t                  conn_handle;                      /**< Handle of the current connection (as provided by the BLE stack, is BLE_CONN_HANDLE_INVALID if not in a connection). */
-    ble_gatts_char_handles_t  dc_handles;
-    ble_gatts_char_handles_t  awd_handles;
-    ble_gatts_char_handles_t  aws_handles;
-    ble_gatts_char_handles_t  dp_handles;
-    ble_gatts_char_handles_t  el_handles;
-    ble_gatts_char_handles_t  gf_handles;
-    ble_gatts_char_handles_t  hi_handles;
-    ble_gatts_char_handles_t  hum_handles;
-    ble_gatts_char_handles_t  ird_handles;
-    ble_gatts_char_handles_t  pc_handles;
-    ble_gatts_char_handles_t  rf_handles;
-    ble_gatts_char_handles_t  ps_handles;
-    ble_gatts_char_handles_t  tem_handles;
-    ble_gatts_char_handles_t  twd_handles;
-    ble_gatts_char_handles_t  tws_handles;
-    ble_gatts_char_handles_t  uvi_handles;
-    ble_gatts_char_handles_t  wc_handles;
-    ble_gatts_char_handles_t  bpt_handles;
-    ble_gatts_char_handles_t  md_handles;
-    ble_gatts_char_handles_t  mfd2d_handles;
-    ble_gatts_char_handles_t  mfd3d_handles;
+    ble_ess_evt_handler_t     evt_handler;                      /**< Event handler to be called for handling events in the Environmental Sensing Service. */
+    uint16_t                  service_handle;                   /**< Handle of Environmental Sensing Service (as provided by the BLE stack). */
+    ble_gatts_char_handles_t  dc_handles;                       /**< Handles of the Descriptor Value Changed characteristic. */
+    ble_ess_char_ctx_t        chars[BLE_ESS_CHAR_ENABLED_COUNT];/**< Built-in characteristics, in @ref ble_ess_char_t order. */
+    blcm_link_ctx_storage_t * const p_link_ctx_storage;         /**< Pointer to link context storage with handles of all current connections and its context. */
 };
 
 
@@ -277,322 +267,46 @@ struct ble_ess_s
 ret_code_t ble_ess_init(ble_ess_t * p_ess, const ble_ess_init_t * p_ess_init);
 
 
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess                     Environmental Sensing Service structure.
- * @param[in]   apparent_wind_direction   New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_apparent_wind_direction_update(ble_ess_t * p_ess,
-                                                  uint16_t    apparent_wind_direction);
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess                 Environmental Sensing Service structure.
- * @param[in]   apparent_wind_speed   New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_apparent_wind_speed_update(ble_ess_t * p_ess,
-                                              uint16_t    apparent_wind_speed);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   dew_point       New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_dew_point_update(ble_ess_t * p_ess,
-                                    int8_t      dew_point);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   elevation       New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_elevation_update(ble_ess_t * p_ess,
-                                    int32_t     elevation);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   gust_factor     New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_gust_factor_update(ble_ess_t * p_ess,
-                                      uint8_t     gust_factor);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   heat_index      New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_heat_index_update(ble_ess_t * p_ess,
-                                     int8_t      heat_index);
-
-
-/**@brief Function for updating the battery level.
+/**@brief Function for updating the value of a characteristic.
  *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
+ * @details The value is written to the attribute table if it changed, and notified on every
+ *          link that enabled notification and whose ES Trigger Setting condition is met.
  *
  * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   humidity        New battery measurement value (in percent of full capacity).
+ * @param[in]   characteristic  Characteristic to update.
+ * @param[in]   p_value         New value, one entry per component, in characteristic units.
+ * @param[in]   conn_handle     Connection handle to notify on, or BLE_CONN_HANDLE_ALL for all
+ *                              connected peripheral links.
  *
+ * @retval      NRF_ERROR_NOT_SUPPORTED if the characteristic is not built in.
  * @return      NRF_SUCCESS on success, otherwise an error code.
  */
-ret_code_t ble_ess_humidity_update(ble_ess_t * p_ess,
-                                   uint16_t    humidity);
+ret_code_t ble_ess_char_update(ble_ess_t      * p_ess,
+                               ble_ess_char_t   characteristic,
+                               int32_t const  * p_value,
+                               uint16_t         conn_handle);
 
 
-/**@brief Function for updating the battery level.
+/**@brief Function for publishing several characteristics in one pass.
  *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
+ * @details Only fields that differ from the attribute table are encoded and written to it. Fields whose ES Trigger Setting condition is met are notified, queued
+ *          back to back so that they go out in the same connection event. Notifications that do not fit in the SoftDevice queue are kept
+ *          pending and sent again when a BLE_GATTS_EVT_HVN_TX_COMPLETE event frees the queue.
  *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   irradiance      New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_irradiance_update(ble_ess_t * p_ess,
-                                     uint16_t    irradiance);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess                 Environmental Sensing Service structure.
- * @param[in]   pollen_concentration  New battery measurement value (in percent of full capacity).
+ *          Triggers are evaluated per link, so each client gets the values its own history calls for.
  *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_pollen_concentration_update(ble_ess_t * p_ess,
-                                               uint32_t    pollen_concentration);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   rainfall        New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_rainfall_update(ble_ess_t * p_ess,
-                                   uint16_t    rainfall);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   pressure        New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_pressure_update(ble_ess_t * p_ess,
-                                   uint32_t    pressure);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   temperature     New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_temperature_update(ble_ess_t * p_ess,
-                                      int16_t     temperature);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess                 Environmental Sensing Service structure.
- * @param[in]   true_wind_direction   New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_true_wind_direction_update(ble_ess_t * p_ess,
-                                              uint16_t    true_wind_direction);
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess             Environmental Sensing Service structure.
- * @param[in]   true_wind_speed   New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_true_wind_speed_update(ble_ess_t * p_ess,
-                                          uint16_t    true_wind_speed);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   uv_index        New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_uv_index_update(ble_ess_t * p_ess,
-                                   uint8_t     uv_index);
-
-                                             
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   wind_chill      New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_wind_chill_update(ble_ess_t * p_ess,
-                                     int8_t      wind_chill);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess                       Environmental Sensing Service structure.
- * @param[in]   barometric_pressure_trend   New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_barometric_pressure_trend_update(ble_ess_t * p_ess,
-                                                    uint8_t     barometric_pressure_trend);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess                 Environmental Sensing Service structure.
- * @param[in]   magnetic_declination  New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_magnetic_declination_update(ble_ess_t * p_ess,
-                                               uint16_t    magnetic_declination);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   mdf2d           New battery measurement value (in percent of full capacity).
- *
- * @return      NRF_SUCCESS on success, otherwise an error code.
- */
-ret_code_t ble_ess_mfd2d_update(ble_ess_t                  * p_ess,
-                                magnetic_flux_density_2d_t   mdf2d);
-
-
-/**@brief Function for updating the battery level.
- *
- * @details The application calls this function after having performed a battery measurement.
- *          The battery level characteristic will only be sent to the clients which have
- *          enabled notifications. \ref BLE_CONN_HANDLE_ALL can be used as a connection handle
- *          to send notifications to all connected devices.
- *
- * @param[in]   p_ess           Environmental Sensing Service structure.
- * @param[in]   mdf3d           New battery measurement value (in percent of full capacity).
+ * @param[in]   p_ess       Environmental Sensing Service structure.
+ * @param[in]   p_snapshot  New sensor values.
+ * @param[in]   conn_handle Connection handle to notify on, or BLE_CONN_HANDLE_ALL for all
+ *                          connected peripheral links.
+ * @param[out]  p_result    Number of sent and deferred notifications, summed over the links. Can be NULL.
  *
  * @return      NRF_SUCCESS on success, otherwise an error code.
  */
-ret_code_t ble_ess_mfd3d_update(ble_ess_t                  * p_ess,
-                                magnetic_flux_density_3d_t   mdf3d);
+ret_code_t ble_ess_snapshot_publish(ble_ess_t                * p_ess,
+                                    ble_ess_snapshot_t const * p_snapshot,
+                                    uint16_t                   conn_handle,
+                                    ble_ess_publish_result_t * p_result);
 
 
 /**@brief Function for handling the Application's BLE Stack events.
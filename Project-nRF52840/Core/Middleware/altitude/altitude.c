@@ -0,0 +1,79 @@
+#include <math.h>
+
+#include "altitude.h"
+
+#define ALTITUDE_EXPONENT               0.19022f    /**< R * L / (g * M) of the standard atmosphere. */
+#define ALTITUDE_LAPSE_RATE             0.0065f     /**< Temperature drop, K/m. */
+#define ALTITUDE_ZERO_CELSIUS           273.15f
+
+#define ALTITUDE_RATIO_LOWER            0.5f        /**< Pressure ratios the polynomial is fitted on. */
+#define ALTITUDE_RATIO_UPPER            1.25f
+#define ALTITUDE_RATIO_CENTER           0.875f
+
+/**@brief x^0.19022 around ALTITUDE_RATIO_CENTER, Chebyshev interpolation expanded into powers of
+ *        (x - ALTITUDE_RATIO_CENTER), lowest first.
+ */
+static const float m_power_poly[] =
+{
+     9.749196768e-01f,
+     2.119417638e-01f,
+    -9.810953587e-02f,
+     6.765223294e-02f,
+    -5.298501253e-02f,
+     4.597329348e-02f,
+    -5.716706440e-02f,
+     5.490554869e-02f
+};
+
+static float m_qnh = ALTITUDE_QNH_DEFAULT;
+
+
+/**@brief Raise a pressure ratio to ALTITUDE_EXPONENT. */
+static float ratio_power(float ratio)
+{
+    float    u;
+    float    res;
+    uint32_t i;
+
+    if ((ratio < ALTITUDE_RATIO_LOWER) || (ratio > ALTITUDE_RATIO_UPPER))
+    {
+        return powf(ratio, ALTITUDE_EXPONENT);
+    }
+
+    u   = ratio - ALTITUDE_RATIO_CENTER;
+    i   = sizeof(m_power_poly) / sizeof(m_power_poly[0]) - 1;
+    res = m_power_poly[i];
+
+    while (i-- > 0)
+    {
+        res = res * u + m_power_poly[i];
+    }
+
+    return res;
+}
+
+
+void altitude_qnh_set(float qnh)
+{
+    if (qnh > 0.0f)
+    {
+        m_qnh = qnh;
+    }
+}
+
+
+float altitude_qnh_get(void)
+{
+    return m_qnh;
+}
+
+
+float altitude_get(float pressure, float temperature)
+{
+    float res;
+
+    res = ratio_power(pressure / m_qnh);
+    res = 1.0f - res;
+
+    return res * ((temperature + ALTITUDE_ZERO_CELSIUS) / ALTITUDE_LAPSE_RATE);
+}
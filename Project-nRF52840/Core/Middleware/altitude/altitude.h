@@ -0,0 +1,39 @@
+#ifndef _ALTITUDE_H_
+#define _ALTITUDE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ALTITUDE_QNH_DEFAULT            1013.96f    /**< Reference sea level pressure until one is set, hPa. */
+
+/**@brief Function for setting the sea level pressure altitudes are referred to.
+ *
+ * @param[in] qnh  Reference pressure, hPa. Values that are not positive are ignored.
+ */
+void altitude_qnh_set(float qnh);
+
+/**@brief Function for getting the reference pressure in use, hPa. */
+float altitude_qnh_get(void);
+
+/**@brief Function for converting a pressure to an altitude with the hypsometric formula.
+ *
+ * @details (p / QNH)^0.19022 is a degree 7 polynomial in single precision for pressure ratios
+ *          from 0.5 to 1.25, about -2000 m to 5500 m. The relative error there is below
+ *          3.1e-7, which is under 0.016 m of altitude from -20 to 50 degree Celsius. Outside
+ *          of it the result falls back to powf(). test/altitude_test.c checks both.
+ *
+ * @param[in] pressure     Pressure, hPa.
+ * @param[in] temperature  Temperature at the sensor, degree Celsius.
+ *
+ * @return Altitude above the reference pressure, m.
+ */
+float altitude_get(float pressure, float temperature);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ALTITUDE_H_ */
@@ -1,83 +1,359 @@
+#include <string.h>
+
+#include "app_timer.h"
+#include "crc16.h"
+#include "fds.h"
+#include "nrf_log.h"
+
 #include "peripherals.h"
+#include "sensor_scheduler.h"
+#include "altitude.h"
 
 #include "barometer.h"
 
-static uint16_t barometer_twi_time;
+#define BAROMETER_DEFAULT_MODE          ICP_CMD_MEASURE_N_P_FIRST
+#define BAROMETER_OTP_FILE_ID           0x4250      /**< fds file holding the calibration cache, must not collide with the Peer Manager range. */
+#define BAROMETER_OTP_RECORD_KEY        0x0001
+#define BAROMETER_TICKS_PER_SECOND      (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
+
+typedef enum
+{
+    BARO_STATE_IDLE = 0,
+    BARO_STATE_CONVERTING,
+    BARO_STATE_READING
+} baro_state_t;
+
+/**@brief OTP calibration words as cached in flash. */
+typedef struct
+{
+    uint16_t device_id;                 /**< ICPPress_ReadID() of the sensor the words were read from. */
+    uint16_t constants[4];
+    uint16_t crc;                       /**< CRC16 of the fields above. */
+} barometer_otp_record_t;
+
+STATIC_ASSERT((sizeof(barometer_otp_record_t) % sizeof(uint32_t)) == 0);
+
+static barometer_otp_record_t m_otp_record;         /**< Record being written, must stay valid until FDS_EVT_WRITE. */
+
+static uint8_t m_baro_job_id;
+static volatile baro_state_t m_baro_state = BARO_STATE_IDLE;
+static volatile uint16_t m_baro_mode = BAROMETER_DEFAULT_MODE;
 
 static float m_temperature;
 static float m_pressure;
 static float m_altitude;
+static bool m_sample_valid;                         /**< The last conversion succeeded. */
 
 static ICPPRess_Def_t m_barometer_def;
+static barometer_sample_handler_t m_sample_handler;
+
+static uint8_t m_baro_cmd[2];
+static uint8_t m_baro_adc[ICP_ADC_DATA_SIZE];
 
-static void barometer_comm_polling_handler(void);
-static void barometer_timer_event_handler(void);
+static ret_code_t barometer_conversion_start(void);
+static ret_code_t barometer_conversion_fetch(void);
+static void barometer_cmd_done_handler(ret_code_t result, void * p_user_data);
+static void barometer_read_done_handler(ret_code_t result, void * p_user_data);
+
+static nrf_twi_mngr_transfer_t const m_baro_cmd_transfers[] =
+{
+    NRF_TWI_MNGR_WRITE(ICP_I2C_ADDRESS, m_baro_cmd, sizeof(m_baro_cmd), 0)
+};
+
+static nrf_twi_mngr_transfer_t const m_baro_read_transfers[] =
+{
+    NRF_TWI_MNGR_READ(ICP_I2C_ADDRESS, m_baro_adc, sizeof(m_baro_adc), 0)
+};
+
+static nrf_twi_mngr_transaction_t const m_baro_cmd_transaction =
+{
+    .callback            = barometer_cmd_done_handler,
+    .p_user_data         = NULL,
+    .p_transfers         = m_baro_cmd_transfers,
+    .number_of_transfers = ARRAY_SIZE(m_baro_cmd_transfers),
+    .p_required_twi_cfg  = NULL
+};
+
+static nrf_twi_mngr_transaction_t const m_baro_read_transaction =
+{
+    .callback            = barometer_read_done_handler,
+    .p_user_data         = NULL,
+    .p_transfers         = m_baro_read_transfers,
+    .number_of_transfers = ARRAY_SIZE(m_baro_read_transfers),
+    .p_required_twi_cfg  = NULL
+};
 
 static ICPPress_State_t barometer_comm_handle(ICPPress_Event_t icp_event, uint16_t device_address, uint8_t *data_buffer, uint16_t data_buffer_size, void *context)
 {
+    ret_code_t err_code;
     uint8_t restart_i2c;
+
     switch (icp_event)
     {
         case I2C_EVENT_TRANSMIT:
         {
-            if (NULL == context)
-            {
-                return baro_peripherals_twi_tx(device_address, data_buffer, data_buffer_size, false);
-            }
-            else
-            {
-                restart_i2c = *((uint8_t *)context);
-                return baro_peripherals_twi_tx(device_address, data_buffer, data_buffer_size, restart_i2c);
-            }
+            restart_i2c = (NULL == context) ? 0 : *((uint8_t *)context);
+            err_code = baro_peripherals_twi_tx(device_address, data_buffer, data_buffer_size, restart_i2c);
             break;
         }
         
         case I2C_EVENT_RECEIVE:
         {
-            return baro_peripherals_twi_rx(device_address, data_buffer, data_buffer_size);
+            err_code = baro_peripherals_twi_rx(device_address, data_buffer, data_buffer_size);
             break;
         }
 
-        default: break;
+        default:
+        {
+            /* The driver never combines a transfer, every read is preceded by its own write */
+            return ICP_UNKNOWN_ERROR;
+        }
     }
+
+    return (NRF_SUCCESS == err_code) ? ICP_OK : ICP_COMM_ERROR;
 }
 
 
+/**@brief Blocking delay of the driver, the sensor is never reported busy. */
 static uint8_t barometer_delay_handle(uint32_t delay_time_ms)
 {
     peripherals_delay_ms(delay_time_ms);
+
+    return false;
 }
 
 
-static void barometer_comm_polling_handler(void)
+/**@brief Conversion time of a measurement mode in app_timer ticks, rounded up. */
+static uint32_t barometer_conversion_ticks(uint16_t mode_cmd)
 {
-    if (BAROMETER_TWI_PROCESS_DATA_PERIOD <= barometer_twi_time)
+    return (uint32_t)(((uint64_t)ICPPress_GetConversionTime(mode_cmd) * BAROMETER_TICKS_PER_SECOND + 999999) / 1000000);
+}
+
+
+static void barometer_sample_complete(ret_code_t result)
+{
+    barometer_sample_t sample;
+    barometer_sample_handler_t sample_handler = m_sample_handler;
+
+    sample.temperature = m_temperature;
+    sample.pressure    = m_pressure;
+    sample.altitude    = m_altitude;
+
+    m_sample_handler = NULL;
+    m_sample_valid = (NRF_SUCCESS == result);
+    m_baro_state = BARO_STATE_IDLE;
+
+    if (NULL != sample_handler)
     {
-        barometer_read_sensor_data();
-        barometer_twi_time = 0;
+        sample_handler(result, &sample);
     }
 }
 
 
-static void barometer_timer_event_handler(void)
+/**@brief Measurement command has been written, the sensor converts while the CPU sleeps until
+ *        the sensor scheduler calls barometer_conversion_fetch().
+ */
+static void barometer_cmd_done_handler(ret_code_t result, void * p_user_data)
 {
-    if (0xFFFF != barometer_twi_time)
+    UNUSED_PARAMETER(p_user_data);
+
+    if (NRF_SUCCESS != result)
     {
-        barometer_twi_time++;
+        barometer_sample_complete(result);
     }
 }
 
 
+/**@brief Sensor scheduler start handler, writes the measurement command. */
+static ret_code_t barometer_conversion_start(void)
+{
+    ret_code_t err_code;
+    uint16_t   mode_cmd = m_baro_mode;
+
+    if (BARO_STATE_IDLE != m_baro_state)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    if (mode_cmd != m_barometer_def.sensorMeasurementMode)
+    {
+        /* The scheduler takes the latency after the start handler returns, so it already covers this conversion */
+        ICPPress_SelectMeasurementMode(&m_barometer_def, mode_cmd);
+        sensor_scheduler_latency_set(m_baro_job_id, barometer_conversion_ticks(mode_cmd));
+    }
+
+    m_baro_cmd[0] = m_barometer_def.sensorMeasurementMode >> 8;
+    m_baro_cmd[1] = m_barometer_def.sensorMeasurementMode;
+
+    m_baro_state = BARO_STATE_CONVERTING;
+
+    err_code = baro_peripherals_twi_schedule(&m_baro_cmd_transaction);
+    if (NRF_SUCCESS != err_code)
+    {
+        m_baro_state = BARO_STATE_IDLE;
+    }
+
+    return err_code;
+}
+
+
+/**@brief Sensor scheduler fetch handler, reads the result once the conversion time has elapsed. */
+static ret_code_t barometer_conversion_fetch(void)
+{
+    ret_code_t err_code;
+
+    if (BARO_STATE_CONVERTING != m_baro_state)
+    {
+        /* The command write failed and the sample has been completed already */
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_baro_state = BARO_STATE_READING;
+
+    err_code = baro_peripherals_twi_schedule(&m_baro_read_transaction);
+    if (NRF_SUCCESS != err_code)
+    {
+        barometer_sample_complete(err_code);
+    }
+
+    return err_code;
+}
+
+
+static void barometer_read_done_handler(ret_code_t result, void * p_user_data)
+{
+    int16_t raw_temperature;
+    uint32_t raw_pressure;
+    int32_t temperature = 0;
+    uint32_t pressure = 0;
+
+    UNUSED_PARAMETER(p_user_data);
+
+    if (NRF_SUCCESS == result)
+    {
+        if ((ICP_OK != ICPPress_DecodeRawData(&m_barometer_def, m_baro_adc, &raw_temperature, &raw_pressure)) ||
+            (ICP_OK != ICPPress_ProcessRawDataFixed(&m_barometer_def, raw_temperature, raw_pressure, &temperature, &pressure)))
+        {
+            result = NRF_ERROR_INVALID_DATA;
+        }
+        else
+        {
+            m_temperature = (float)temperature / 100.0f;
+            m_pressure    = (float)pressure / 10000.0f;
+            m_altitude    = altitude_get(m_pressure, m_temperature);
+        }
+    }
+
+    barometer_sample_complete(result);
+}
+
+
+static uint16_t barometer_otp_crc(barometer_otp_record_t const * p_record)
+{
+    return crc16_compute((uint8_t const *)p_record, offsetof(barometer_otp_record_t, crc), NULL);
+}
+
+
+/**@brief Load the calibration from the flash cache if it was saved for this sensor.
+ *
+ * @return true if the OTP words do not need to be read.
+ */
+static bool barometer_otp_cache_load(uint16_t device_id, fds_record_desc_t * p_desc, bool * p_found)
+{
+    fds_find_token_t               token;
+    fds_flash_record_t             record;
+    barometer_otp_record_t const * p_record;
+    bool                           loaded = false;
+
+    memset(&token, 0, sizeof(token));
+
+    *p_found = (fds_record_find(BAROMETER_OTP_FILE_ID, BAROMETER_OTP_RECORD_KEY, p_desc, &token) == NRF_SUCCESS);
+    if (!*p_found || (fds_record_open(p_desc, &record) != NRF_SUCCESS))
+    {
+        return false;
+    }
+
+    p_record = (barometer_otp_record_t const *)record.p_data;
+
+    if ((record.p_header->length_words == BYTES_TO_WORDS(sizeof(barometer_otp_record_t))) &&
+        (p_record->device_id == device_id) &&
+        (p_record->crc == barometer_otp_crc(p_record)))
+    {
+        loaded = (ICP_OK == ICPPress_LoadCalibration(&m_barometer_def, p_record->constants));
+    }
+
+    (void)fds_record_close(p_desc);
+
+    return loaded;
+}
+
+
+/**@brief Save the calibration read from OTP, replacing a stale record. */
+static void barometer_otp_cache_save(uint16_t device_id, fds_record_desc_t * p_desc, bool found)
+{
+    ret_code_t   err_code;
+    fds_record_t record =
+    {
+        .file_id           = BAROMETER_OTP_FILE_ID,
+        .key               = BAROMETER_OTP_RECORD_KEY,
+        .data.p_data       = &m_otp_record,
+        .data.length_words = BYTES_TO_WORDS(sizeof(m_otp_record))
+    };
+
+    m_otp_record.device_id = device_id;
+    memcpy(m_otp_record.constants, m_barometer_def.sensorConstants, sizeof(m_otp_record.constants));
+    m_otp_record.crc       = barometer_otp_crc(&m_otp_record);
+
+    err_code = found ? fds_record_update(p_desc, &record) : fds_record_write(NULL, &record);
+    if (err_code != NRF_SUCCESS)
+    {
+        // Not fatal, the OTP words are read again on the next boot.
+        NRF_LOG_WARNING("Barometer calibration not cached: 0x%x", err_code);
+    }
+}
+
+
+/**@brief Calibrate from the flash cache, or from OTP on the first boot with this sensor. */
+static void barometer_calibrate(void)
+{
+    fds_record_desc_t desc;
+    uint16_t          device_id;
+    bool              found = false;
+
+    if (ICP_OK != ICPPress_ReadID(&m_barometer_def, &device_id))
+    {
+        APP_ERROR_CHECK(NRF_ERROR_INTERNAL);
+    }
+
+    if (barometer_otp_cache_load(device_id, &desc, &found))
+    {
+        return;
+    }
+
+    APP_ERROR_CHECK((ICP_OK == ICPPress_Init(&m_barometer_def)) ? NRF_SUCCESS : NRF_ERROR_INTERNAL);
+
+    barometer_otp_cache_save(device_id, &desc, found);
+}
+
+
 void barometer_init(void)
 {
+    sensor_scheduler_job_t const baro_job =
+    {
+        .start_handler = barometer_conversion_start,
+        .fetch_handler = barometer_conversion_fetch,
+        .period        = SENSOR_SCHEDULER_PERIOD_PUBLISH,
+        .latency       = barometer_conversion_ticks(BAROMETER_DEFAULT_MODE),
+        .jitter        = BAROMETER_SAMPLE_JITTER
+    };
+
     m_barometer_def.commHandle = barometer_comm_handle;
     m_barometer_def.delayHandle = barometer_delay_handle;
 
-    peripherals_assign_comm_handle(BAROMETER_COMM, barometer_comm_polling_handler);
-    peripherals_assign_comm_handle(TIMER_BAROMETER, barometer_timer_event_handler);
+    APP_ERROR_CHECK(sensor_scheduler_register(&baro_job, &m_baro_job_id));
 
-    APP_ERROR_CHECK(ICPPress_Init(&m_barometer_def));
-    ICPPress_SetMeasurementMode(&m_barometer_def, ICP_CMD_MEASURE_N_P_FIRST);
+    barometer_calibrate();
+    ICPPress_SetMeasurementMode(&m_barometer_def, BAROMETER_DEFAULT_MODE);
 
     m_barometer_def.delayHandle(10);
 }
@@ -85,7 +361,47 @@ void barometer_init(void)
 
 void barometer_read_sensor_data(void)
 {
-    APP_ERROR_CHECK(ICPPress_GetProcessedData(&m_barometer_def, &m_temperature, &m_pressure, &m_altitude));
+    ret_code_t err_code = barometer_sample_async(NULL);
+
+    if (NRF_ERROR_BUSY != err_code)
+    {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Take a sample outside of the barometer period, the result is fetched after the conversion time. */
+ret_code_t barometer_sample_async(barometer_sample_handler_t sample_handler)
+{
+    ret_code_t err_code;
+
+    if (BARO_STATE_IDLE != m_baro_state)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    m_sample_handler = sample_handler;
+
+    err_code = sensor_scheduler_job_run(m_baro_job_id);
+    if (NRF_SUCCESS != err_code)
+    {
+        m_sample_handler = NULL;
+    }
+
+    return err_code;
+}
+
+
+ret_code_t barometer_mode_set(uint16_t mode_cmd)
+{
+    if (0 == ICPPress_GetConversionTime(mode_cmd))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_baro_mode = mode_cmd;
+
+    return NRF_SUCCESS;
 }
 
 
@@ -93,3 +409,19 @@ void barometer_get_altitude(float *altitude)
 {
     *altitude = m_altitude;
 }
+
+
+bool barometer_data_get(barometer_sample_t * p_sample)
+{
+    p_sample->temperature = m_temperature;
+    p_sample->pressure    = m_pressure;
+    p_sample->altitude    = m_altitude;
+
+    return m_sample_valid;
+}
+
+
+uint32_t barometer_sample_age_get(void)
+{
+    return sensor_scheduler_sample_age_get(m_baro_job_id);
+}
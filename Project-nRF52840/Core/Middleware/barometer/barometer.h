@@ -2,7 +2,9 @@
 #define _BAROMETER_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
+#include "sdk_errors.h"
 #include "ICP101xx.h"
 #include "Miscellaneous.h"
 
@@ -10,10 +12,48 @@
 extern "C" {
 #endif
 
+typedef struct
+{
+    float temperature;
+    float pressure;
+    float altitude;
+} barometer_sample_t;
+
+/**@brief Completion callback of an asynchronous barometer sample, called from interrupt context. */
+typedef void (*barometer_sample_handler_t)(ret_code_t result, barometer_sample_t const * p_sample);
+
+/**@brief Function for setting up the ICP101xx and its sensor scheduler job.
+ *
+ * @details The OTP calibration is cached in flash for the sensor ID read at start up, fds must
+ *          be initialized already. Without the cache the OTP words are read as on a first boot.
+ */
 void barometer_init(void);
 void barometer_read_sensor_data(void);
+ret_code_t barometer_sample_async(barometer_sample_handler_t sample_handler);
+
+/**@brief Function for switching the ICP101xx measurement mode, e.g. ICP_CMD_MEASURE_LP_P_FIRST for fast
+ *        altitude tracking or ICP_CMD_MEASURE_ULN_P_FIRST for weather grade pressure.
+ *
+ * @details Takes effect from the next conversion, the fetch is then delayed by the conversion time of the new mode.
+ *
+ * @retval NRF_ERROR_INVALID_PARAM if mode_cmd is not an ICP_CMD_MEASURE_* command.
+ */
+ret_code_t barometer_mode_set(uint16_t mode_cmd);
 void barometer_get_altitude(float *altitude);
 
+/**@brief Function for reading the latest result, temperature in degree Celsius, pressure in hPa
+ *        and altitude in m.
+ *
+ * @details Must be called at the app_timer priority, which the TWI completion shares, so the
+ *          three values always come from one conversion.
+ *
+ * @return false if the last conversion failed or none completed yet.
+ */
+bool barometer_data_get(barometer_sample_t * p_sample);
+
+/**@brief Function for getting the ticks since the last conversion was read out. */
+uint32_t barometer_sample_age_get(void);
+
 #ifdef __cplusplus
 }
 #endif
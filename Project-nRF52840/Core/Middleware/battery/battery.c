@@ -0,0 +1,102 @@
+#include "nrf_log.h"
+
+#include "peripherals.h"
+#include "battery.h"
+
+static battery_init_t m_config;
+static uint8_t        m_countdown;              /**< BLE updates until the next evaluation. */
+static uint16_t       m_gauge_mv;               /**< Voltage the level was computed from, 0 before the first one. */
+static uint8_t        m_level;
+static bool           m_level_valid;
+
+
+/**@brief Interpolate the state of charge between the two curve points around the voltage. */
+static uint8_t curve_lookup(uint16_t millivolts)
+{
+    battery_curve_point_t const * p_curve = m_config.p_curve;
+    battery_curve_point_t const * p_upper;
+    battery_curve_point_t const * p_lower;
+
+    if (millivolts >= p_curve[0].millivolts)
+    {
+        return p_curve[0].percent;
+    }
+
+    for (uint8_t i = 1; i < m_config.curve_points; i++)
+    {
+        if (millivolts >= p_curve[i].millivolts)
+        {
+            p_upper = &p_curve[i - 1];
+            p_lower = &p_curve[i];
+
+            return p_lower->percent + ((uint32_t)(millivolts - p_lower->millivolts) * (p_upper->percent - p_lower->percent))
+                                    / (p_upper->millivolts - p_lower->millivolts);
+        }
+    }
+
+    return p_curve[m_config.curve_points - 1].percent;
+}
+
+
+ret_code_t battery_init(battery_init_t const * p_battery_init)
+{
+    if ((NULL == p_battery_init) || (NULL == p_battery_init->p_curve))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (p_battery_init->curve_points < 2)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    m_config = *p_battery_init;
+
+    return NRF_SUCCESS;
+}
+
+
+bool battery_level_update(uint8_t * p_level)
+{
+    uint16_t millivolts;
+    uint8_t  level;
+
+    if (m_countdown > 0)
+    {
+        m_countdown--;
+        return false;
+    }
+
+    if (adc_sample_age_get() == UINT32_MAX)
+    {
+        // No scan has completed yet.
+        return false;
+    }
+
+    m_countdown = BATTERY_GAUGE_PERIOD - 1;
+
+    battery_read_voltage(&millivolts);
+
+    if ((m_gauge_mv != 0) &&
+        (millivolts < m_gauge_mv + BATTERY_HYSTERESIS_MV) &&
+        (millivolts + BATTERY_HYSTERESIS_MV > m_gauge_mv))
+    {
+        return false;
+    }
+
+    m_gauge_mv = millivolts;
+    level      = curve_lookup(millivolts);
+
+    NRF_LOG_DEBUG("Battery %d mV, %d %%", millivolts, level);
+
+    if (m_level_valid && (level == m_level))
+    {
+        return false;
+    }
+
+    m_level       = level;
+    m_level_valid = true;
+    *p_level      = level;
+
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef _BATTERY_H_
+#define _BATTERY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BATTERY_GAUGE_PERIOD            12          /**< BLE updates between two state of charge evaluations. */
+#define BATTERY_HYSTERESIS_MV           8           /**< Voltage change needed before the state of charge is recomputed. */
+
+/**@brief One point of a discharge curve. */
+typedef struct
+{
+    uint16_t millivolts;        /**< Open circuit cell voltage. */
+    uint8_t  percent;           /**< State of charge at that voltage. */
+} battery_curve_point_t;
+
+typedef struct
+{
+    battery_curve_point_t const * p_curve;              /**< Discharge curve, sorted by falling voltage. */
+    uint8_t                       curve_points;         /**< Number of points in p_curve, at least 2. */
+} battery_init_t;
+
+/**@brief Function for setting up the gauge. The voltage itself comes from the SAADC scan. */
+ret_code_t battery_init(battery_init_t const * p_battery_init);
+
+/**@brief Function for running the gauge, called on every BLE update.
+ *
+ * @details Only every BATTERY_GAUGE_PERIOD call evaluates the curve. The voltage is not corrected
+ *          for the radio load: 5 mA through the 150 mOhm of a cell and its protection circuit drop
+ *          at most 0.75 mV, half a step of the VDDH/5 channel and well under BATTERY_HYSTERESIS_MV.
+ *
+ * @param[out] p_level  State of charge, percent.
+ *
+ * @return true if p_level changed since it was last returned.
+ */
+bool battery_level_update(uint8_t * p_level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BATTERY_H_ */
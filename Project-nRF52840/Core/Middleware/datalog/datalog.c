@@ -0,0 +1,526 @@
+#include <string.h>
+
+#include "app_util.h"
+#include "app_timer.h"
+#include "fds.h"
+#include "nrf_log.h"
+
+#include "datalog.h"
+
+#define DATALOG_TICKS_PER_SECOND        (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
+
+typedef enum
+{
+    DATALOG_WRITE_IDLE = 0,             /**< No block waiting for flash. */
+    DATALOG_WRITE_QUEUED,               /**< Block handed to fds, waiting for FDS_EVT_WRITE. */
+    DATALOG_WRITE_WAIT_QUEUE,           /**< The fds queue was full, block is written again once an operation completes. */
+    DATALOG_WRITE_WAIT_GC_QUEUE,        /**< Flash was full and the oldest block deleted, garbage collection waits for queue space. */
+    DATALOG_WRITE_WAIT_GC               /**< Flash was full, block is written again after FDS_EVT_GC. */
+} datalog_write_state_t;
+
+/**@brief One sample as stored in flash, relative to the block it is in. */
+typedef struct
+{
+    uint16_t time_offset;               /**< Seconds after the block base timestamp. */
+    int16_t  temperature;
+    uint16_t humidity;
+    uint8_t  uv_index;
+    uint8_t  reserved;
+    uint32_t pressure;
+    int32_t  elevation;
+} datalog_entry_t;
+
+/**@brief Payload of one fds record. */
+typedef struct
+{
+    uint32_t        first_sequence;     /**< Sequence number of entries[0]. */
+    uint32_t        base_timestamp;     /**< Timestamp of entries[0]. */
+    uint8_t         count;              /**< Valid entries. */
+    uint8_t         reserved[3];
+    datalog_entry_t entries[DATALOG_SAMPLES_PER_RECORD];
+} datalog_block_t;
+
+STATIC_ASSERT((sizeof(datalog_block_t) % sizeof(uint32_t)) == 0);
+
+static datalog_block_t m_fill_block;                /**< Block being filled in RAM. */
+static datalog_block_t m_write_block;               /**< Block being written, must stay valid until FDS_EVT_WRITE. */
+static datalog_block_t m_cache_block;               /**< Last block read back from flash. */
+static bool            m_cache_valid;
+
+static volatile datalog_write_state_t m_write_state = DATALOG_WRITE_IDLE;
+
+static uint32_t m_first_sequence;
+static uint32_t m_next_sequence;
+static uint32_t m_record_count;
+static bool     m_initialized;
+
+static uint32_t m_uptime_s;
+static uint32_t m_uptime_ticks;
+static uint32_t m_last_tick;
+
+static void datalog_fds_evt_handler(fds_evt_t const * p_evt);
+
+
+static bool block_contains(datalog_block_t const * p_block, uint32_t sequence)
+{
+    return (p_block->count != 0) &&
+           (sequence >= p_block->first_sequence) &&
+           (sequence - p_block->first_sequence < p_block->count);
+}
+
+
+static void block_sample_get(datalog_block_t const * p_block, uint32_t index, datalog_sample_t * p_sample)
+{
+    datalog_entry_t const * p_entry = &p_block->entries[index];
+
+    p_sample->sequence    = p_block->first_sequence + index;
+    p_sample->timestamp   = p_block->base_timestamp + p_entry->time_offset;
+    p_sample->temperature = p_entry->temperature;
+    p_sample->humidity    = p_entry->humidity;
+    p_sample->pressure    = p_entry->pressure;
+    p_sample->elevation   = p_entry->elevation;
+    p_sample->uv_index    = p_entry->uv_index;
+}
+
+
+/**@brief Function for walking the stored blocks and recovering the sequence range after a reset. */
+static void datalog_scan(void)
+{
+    fds_record_desc_t  desc;
+    fds_find_token_t   token;
+    fds_flash_record_t record;
+    bool               found = false;
+
+    memset(&token, 0, sizeof(token));
+
+    m_record_count = 0;
+
+    while (fds_record_find(DATALOG_FILE_ID, DATALOG_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        datalog_block_t const * p_block;
+
+        if (fds_record_open(&desc, &record) != NRF_SUCCESS)
+        {
+            continue;
+        }
+
+        p_block = (datalog_block_t const *)record.p_data;
+
+        if (!found || (p_block->first_sequence < m_first_sequence))
+        {
+            m_first_sequence = p_block->first_sequence;
+        }
+        if (!found || (p_block->first_sequence + p_block->count > m_next_sequence))
+        {
+            m_next_sequence = p_block->first_sequence + p_block->count;
+        }
+        found = true;
+        m_record_count++;
+
+        (void)fds_record_close(&desc);
+    }
+
+    m_fill_block.first_sequence = m_next_sequence;
+    m_fill_block.count          = 0;
+
+    NRF_LOG_INFO("Data log: %d records, sequence %d..%d", m_record_count, m_first_sequence, m_next_sequence);
+}
+
+
+/**@brief Function for finding the stored block holding sequence, or else the oldest block after it.
+ *
+ * @param[in]  sequence     Sequence number to look for.
+ * @param[out] p_desc       Descriptor of the block. Can be NULL.
+ * @param[out] p_block      Copy of the block. Can be NULL.
+ *
+ * @return     true if a block was found.
+ */
+static bool block_find(uint32_t sequence, fds_record_desc_t * p_desc, datalog_block_t * p_block)
+{
+    fds_record_desc_t  desc;
+    fds_find_token_t   token;
+    fds_flash_record_t record;
+    uint32_t           best_sequence = UINT32_MAX;
+    bool               found = false;
+
+    memset(&token, 0, sizeof(token));
+
+    while (fds_record_find(DATALOG_FILE_ID, DATALOG_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        datalog_block_t const * p_stored;
+
+        if (fds_record_open(&desc, &record) != NRF_SUCCESS)
+        {
+            continue;
+        }
+
+        p_stored = (datalog_block_t const *)record.p_data;
+
+        // An exact hit wins, otherwise keep the closest block that starts after sequence.
+        if (block_contains(p_stored, sequence) ||
+            ((p_stored->first_sequence > sequence) && (p_stored->first_sequence < best_sequence)))
+        {
+            best_sequence = block_contains(p_stored, sequence) ? 0 : p_stored->first_sequence;
+            found         = true;
+
+            if (p_desc != NULL)
+            {
+                *p_desc = desc;
+            }
+            if (p_block != NULL)
+            {
+                memcpy(p_block, p_stored, sizeof(*p_block));
+            }
+        }
+
+        (void)fds_record_close(&desc);
+
+        if (found && (best_sequence == 0))
+        {
+            break;
+        }
+    }
+
+    return found;
+}
+
+
+/**@brief Function for dropping the oldest stored block to make room for a new one.
+ *
+ * @return     false if there was nothing to drop.
+ */
+static bool oldest_block_delete(void)
+{
+    fds_record_desc_t desc;
+    datalog_block_t   block;
+
+    if (!block_find(0, &desc, &block) || (fds_record_delete(&desc) != NRF_SUCCESS))
+    {
+        return false;
+    }
+
+    if (block.first_sequence + block.count > m_first_sequence)
+    {
+        m_first_sequence = block.first_sequence + block.count;
+    }
+    m_cache_valid = false;
+
+    return true;
+}
+
+
+/**@brief Function for starting the garbage collection the waiting block is written after. */
+static void block_gc_start(void)
+{
+    ret_code_t err_code = fds_gc();
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_write_state = DATALOG_WRITE_WAIT_GC;
+    }
+    else if (err_code == FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        m_write_state = DATALOG_WRITE_WAIT_GC_QUEUE;
+    }
+    else
+    {
+        NRF_LOG_WARNING("Data log block %d dropped: 0x%x", m_write_block.first_sequence, err_code);
+        m_write_state = DATALOG_WRITE_IDLE;
+    }
+}
+
+
+/**@brief Function for handing m_write_block to fds. */
+static void block_write(void)
+{
+    ret_code_t   err_code;
+    fds_record_t record =
+    {
+        .file_id           = DATALOG_FILE_ID,
+        .key               = DATALOG_RECORD_KEY,
+        .data.p_data       = &m_write_block,
+        .data.length_words = BYTES_TO_WORDS(sizeof(m_write_block))
+    };
+
+    m_write_state = DATALOG_WRITE_QUEUED;
+
+    err_code = fds_record_write(NULL, &record);
+    if ((err_code == FDS_ERR_NO_SPACE_IN_FLASH) && oldest_block_delete())
+    {
+        // Reclaim the space of the oldest block and try again once garbage collection is done.
+        // With no block of our own left to drop, the flash is full of other data; give up.
+        block_gc_start();
+    }
+    else if (err_code == FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        m_write_state = DATALOG_WRITE_WAIT_QUEUE;
+    }
+    else if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_WARNING("Data log block %d dropped: 0x%x", m_write_block.first_sequence, err_code);
+        m_write_state = DATALOG_WRITE_IDLE;
+    }
+}
+
+
+/**@brief Function for moving the filled block to flash. */
+static void block_flush(void)
+{
+    if ((m_write_state != DATALOG_WRITE_IDLE) || (m_fill_block.count == 0))
+    {
+        return;
+    }
+
+    m_write_block = m_fill_block;
+
+    m_fill_block.first_sequence = m_next_sequence;
+    m_fill_block.count          = 0;
+
+    // Once per block, a write retried before the delete completes must not drop another one.
+    if (m_record_count >= DATALOG_MAX_RECORDS)
+    {
+        (void)oldest_block_delete();
+    }
+
+    block_write();
+}
+
+
+static void datalog_fds_evt_handler(fds_evt_t const * p_evt)
+{
+    switch (p_evt->id)
+    {
+        case FDS_EVT_INIT:
+            if ((p_evt->result == NRF_SUCCESS) && !m_initialized)
+            {
+                datalog_scan();
+                m_initialized = true;
+            }
+            break;
+
+        case FDS_EVT_WRITE:
+            if (p_evt->write.file_id == DATALOG_FILE_ID)
+            {
+                if (p_evt->result == NRF_SUCCESS)
+                {
+                    m_record_count++;
+                }
+                m_write_state = DATALOG_WRITE_IDLE;
+            }
+            break;
+
+        case FDS_EVT_DEL_RECORD:
+            if ((p_evt->del.file_id == DATALOG_FILE_ID) && (p_evt->result == NRF_SUCCESS) && (m_record_count > 0))
+            {
+                m_record_count--;
+            }
+            break;
+
+        case FDS_EVT_DEL_FILE:
+            if ((p_evt->del.file_id == DATALOG_FILE_ID) && (p_evt->result == NRF_SUCCESS))
+            {
+                m_record_count = 0;
+                (void)fds_gc();
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    // A waiting block only goes on once what it waits for is done. The delete of the oldest
+    // block completes before garbage collection has freed its space.
+    switch (m_write_state)
+    {
+        case DATALOG_WRITE_WAIT_QUEUE:
+            // Every completed operation frees a queue entry.
+            block_write();
+            break;
+
+        case DATALOG_WRITE_WAIT_GC_QUEUE:
+            block_gc_start();
+            break;
+
+        case DATALOG_WRITE_WAIT_GC:
+            if (p_evt->id == FDS_EVT_GC)
+            {
+                block_write();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+ret_code_t datalog_init(void)
+{
+    ret_code_t err_code;
+
+    m_last_tick = app_timer_cnt_get();
+
+    err_code = fds_register(datalog_fds_evt_handler);
+    if (err_code != NRF_SUCCESS)
+    {
+        return err_code;
+    }
+
+    // Completes through FDS_EVT_INIT, right away if the Peer Manager already initialized fds.
+    return fds_init();
+}
+
+
+ret_code_t datalog_append(datalog_sample_t * p_sample)
+{
+    datalog_entry_t * p_entry;
+    uint32_t          now = app_timer_cnt_get();
+
+    if (p_sample == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_uptime_ticks += app_timer_cnt_diff_compute(now, m_last_tick);
+    m_last_tick     = now;
+    m_uptime_s     += m_uptime_ticks / DATALOG_TICKS_PER_SECOND;
+    m_uptime_ticks %= DATALOG_TICKS_PER_SECOND;
+
+    // Offsets are 16 bits, start a new block rather than let one span more than 18 hours.
+    if ((m_fill_block.count != 0) && (m_uptime_s - m_fill_block.base_timestamp > UINT16_MAX))
+    {
+        block_flush();
+    }
+
+    if (m_fill_block.count == DATALOG_SAMPLES_PER_RECORD)
+    {
+        // A full block could not be flushed earlier because the one before it was still being written.
+        block_flush();
+    }
+
+    if (m_fill_block.count == DATALOG_SAMPLES_PER_RECORD)
+    {
+        // Still being written, this sample is dropped.
+        return NRF_ERROR_BUSY;
+    }
+
+    p_sample->sequence  = m_next_sequence++;
+    p_sample->timestamp = m_uptime_s;
+
+    if (m_fill_block.count == 0)
+    {
+        m_fill_block.first_sequence = p_sample->sequence;
+        m_fill_block.base_timestamp = p_sample->timestamp;
+    }
+
+    p_entry = &m_fill_block.entries[m_fill_block.count++];
+
+    p_entry->time_offset = (uint16_t)(p_sample->timestamp - m_fill_block.base_timestamp);
+    p_entry->temperature = p_sample->temperature;
+    p_entry->humidity    = p_sample->humidity;
+    p_entry->uv_index    = p_sample->uv_index;
+    p_entry->reserved    = 0;
+    p_entry->pressure    = p_sample->pressure;
+    p_entry->elevation   = p_sample->elevation;
+
+    if (m_fill_block.count == DATALOG_SAMPLES_PER_RECORD)
+    {
+        block_flush();
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t datalog_read(uint32_t sequence, datalog_sample_t * p_sample)
+{
+    datalog_block_t const * p_block = NULL;
+
+    if (p_sample == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if (sequence < m_first_sequence)
+    {
+        sequence = m_first_sequence;
+    }
+
+    if (sequence >= m_next_sequence)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    // Samples not written yet are served from RAM, the rest from the cached or a freshly read block.
+    if (block_contains(&m_fill_block, sequence))
+    {
+        p_block = &m_fill_block;
+    }
+    else if ((m_write_state != DATALOG_WRITE_IDLE) && block_contains(&m_write_block, sequence))
+    {
+        p_block = &m_write_block;
+    }
+    else if (m_cache_valid && block_contains(&m_cache_block, sequence))
+    {
+        p_block = &m_cache_block;
+    }
+    else if (block_find(sequence, NULL, &m_cache_block))
+    {
+        m_cache_valid = true;
+        p_block       = &m_cache_block;
+
+        // Skip over a gap left by a dropped block.
+        if (!block_contains(p_block, sequence))
+        {
+            sequence = p_block->first_sequence;
+        }
+    }
+    else if (m_fill_block.count != 0)
+    {
+        sequence = m_fill_block.first_sequence;
+        p_block  = &m_fill_block;
+    }
+    else
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    block_sample_get(p_block, sequence - p_block->first_sequence, p_sample);
+
+    return NRF_SUCCESS;
+}
+
+
+void datalog_range_get(uint32_t * p_first, uint32_t * p_next)
+{
+    if (p_first != NULL)
+    {
+        *p_first = m_first_sequence;
+    }
+    if (p_next != NULL)
+    {
+        *p_next = m_next_sequence;
+    }
+}
+
+
+ret_code_t datalog_delete_all(void)
+{
+    if (!m_initialized)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_first_sequence = m_next_sequence;
+    m_cache_valid    = false;
+
+    m_fill_block.first_sequence = m_next_sequence;
+    m_fill_block.count          = 0;
+
+    return fds_file_delete(DATALOG_FILE_ID);
+}
@@ -0,0 +1,67 @@
+#ifndef _DATALOG_H_
+#define _DATALOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DATALOG_FILE_ID                 0x4C47      /**< fds file holding the log, must not collide with the Peer Manager range. */
+#define DATALOG_RECORD_KEY              0x0001      /**< fds record key of every log block. */
+
+#define DATALOG_SAMPLES_PER_RECORD      8           /**< Samples packed into one flash record, amortizes the fds record header. */
+#define DATALOG_MAX_RECORDS             160         /**< Records kept before the oldest one is dropped, leaves room for bonds. */
+
+typedef struct
+{
+    uint32_t sequence;          /**< Sequence number, keeps counting across resets. */
+    uint32_t timestamp;         /**< Seconds since power on when the sample was taken. */
+    int16_t  temperature;       /**< Temperature, 0.01 degree Celsius. */
+    uint16_t humidity;          /**< Humidity, 0.01 %. */
+    uint32_t pressure;          /**< Pressure, 0.1 Pa. */
+    int32_t  elevation;         /**< Elevation, 0.01 m. */
+    uint8_t  uv_index;          /**< UV Index. */
+} datalog_sample_t;
+
+/**@brief Function for registering the log with fds and recovering the stored sequence range.
+ *
+ * @note Must be called before fds is initialized, or after it, but not while a flash
+ *       operation of another fds user is outstanding.
+ */
+ret_code_t datalog_init(void);
+
+/**@brief Function for adding a sample to the log.
+ *
+ * @details Samples are collected in RAM and written to flash DATALOG_SAMPLES_PER_RECORD at a
+ *          time. The sequence number and timestamp of the sample are assigned here. Must be
+ *          called at least once every RTC period (1024 s) to keep the timestamp accurate.
+ *
+ * @param[in,out] p_sample  Sample to add; sequence and timestamp are filled in.
+ */
+ret_code_t datalog_append(datalog_sample_t * p_sample);
+
+/**@brief Function for reading the oldest stored sample with a sequence number of at least sequence.
+ *
+ * @retval NRF_ERROR_NOT_FOUND if there is no such sample.
+ */
+ret_code_t datalog_read(uint32_t sequence, datalog_sample_t * p_sample);
+
+/**@brief Function for getting the range of stored sequence numbers.
+ *
+ * @param[out] p_first  Sequence number of the oldest stored sample.
+ * @param[out] p_next   Sequence number the next sample will get; p_next == p_first if the log is empty.
+ */
+void datalog_range_get(uint32_t * p_first, uint32_t * p_next);
+
+/**@brief Function for deleting every stored sample. Sequence numbers keep counting. */
+ret_code_t datalog_delete_all(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DATALOG_H_ */
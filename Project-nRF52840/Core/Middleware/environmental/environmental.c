@@ -1,43 +1,127 @@
-#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "app_util_platform.h"
 
 #include "peripherals.h"
+#include "sensor_scheduler.h"
+#include "altitude.h"
+#include "iaq.h"
 #include "environmental.h"
 
-static uint16_t environmental_spi_time;
+typedef enum
+{
+    ENV_STATE_IDLE = 0,
+    ENV_STATE_MEASURING
+} env_state_t;
+
+/**@brief When a gas reading is refreshed, whichever comes first. */
+typedef struct
+{
+    uint8_t  interval;                  /**< Cycles between two heated cycles at the most. */
+    uint16_t temperature_delta;         /**< Temperature change since the last gas reading, 0.01 degree Celsius. */
+    uint16_t humidity_delta;            /**< Humidity change since the last gas reading, 0.001 %RH. */
+} env_gas_policy_cfg_t;
+
+static const env_gas_policy_cfg_t m_gas_policies[ENV_GAS_POLICY_COUNT] =
+{
+    [ENV_GAS_POLICY_FRESH]    = { .interval = 1,  .temperature_delta = 0,   .humidity_delta = 0    },
+    [ENV_GAS_POLICY_BALANCED] = { .interval = 6,  .temperature_delta = 50,  .humidity_delta = 3000 },
+    [ENV_GAS_POLICY_SAVER]    = { .interval = 36, .temperature_delta = 150, .humidity_delta = 8000 }
+};
+
+#define ENV_GAS_FEATURE_ONE         4096    /**< 1.0 in the scan features. */
+#define ENV_NOISE_SHIFT             3       /**< The noise estimate follows 1/8 of every cycle. */
+#define ENV_NOISE_FRACTION_BITS     8       /**< The noise estimate resolves below one LSB, the quantization alone is 1/12 LSB^2. */
+#define ENV_NOISE_SETTLE_CYCLES     8       /**< Cycles after an oversampling change before the next decision. */
+#define ENV_GAS_BASELINE_SHIFT      7       /**< The baseline follows 1/128 of every scan, hours at the policy intervals. */
+
+/**@brief Noise tracking of one T, P or H channel. */
+typedef struct
+{
+    uint32_t resolution;                /**< Standard deviation the consumer accepts, 0 for any. */
+    int32_t  last;                      /**< Previous reading. */
+    uint64_t diff_power;                /**< Running mean square of the change between two readings, ENV_NOISE_FRACTION_BITS. */
+    uint8_t  cycles;                    /**< Readings since the last oversampling change, saturates. */
+} env_noise_t;
 
-static float m_temperature;
-static float m_pressure;
-static float m_gas_resistance;
-static float m_altitude;
+static const env_gas_step_t m_default_profile[] =
+{
+    { .temperature = 200, .duration = 100 },
+    { .temperature = 250, .duration = 100 },
+    { .temperature = 300, .duration = 100 },
+    { .temperature = 350, .duration = 100 }
+};
+
+static uint8_t m_env_job_id;
+static volatile env_state_t m_env_state = ENV_STATE_IDLE;
 
 static struct bme680_dev m_env_dev;
 static struct bme680_field_data m_env_data;
 
-static void environmental_comm_polling_handle(void);
-static void environmental_timer_event_handler(void);
+static volatile env_gas_policy_t m_gas_policy = ENV_GAS_POLICY_BALANCED;
+static env_gas_stats_t m_gas_stats;
+static uint32_t m_gas_resistance;           /**< Last step of the latest valid scan, the TPH only cycles in between keep it. */
+static int16_t  m_gas_temperature;          /**< Temperature the gas reading was taken at. */
+static uint32_t m_gas_humidity;             /**< Humidity the gas reading was taken at. */
+static bool     m_gas_valid;
+static uint8_t  m_gas_age;                  /**< Cycles since the last heated one. */
+
+static env_gas_step_t m_profile[ENV_GAS_SCAN_MAX_STEPS];
+static uint8_t  m_profile_steps;
+static uint8_t  m_scan_step;                /**< Profile step of the conversion in progress while heating. */
+static bool     m_scan_ok;                  /**< Every step of the scan in progress read a stable value. */
+static uint32_t m_scan_resistance[ENV_GAS_SCAN_MAX_STEPS];
+static uint32_t m_baseline[ENV_GAS_SCAN_MAX_STEPS];  /**< Slow average of every step, the clean air reference. */
+static env_gas_scan_t m_scan;
+
+static env_noise_t m_noise[ENV_CHANNEL_COUNT] =
+{
+    [ENV_CHANNEL_TEMPERATURE] = { .resolution = ENV_RESOLUTION_TEMPERATURE_DEFAULT },
+    [ENV_CHANNEL_PRESSURE]    = { .resolution = ENV_RESOLUTION_PRESSURE_DEFAULT    },
+    [ENV_CHANNEL_HUMIDITY]    = { .resolution = ENV_RESOLUTION_HUMIDITY_DEFAULT    }
+};
+
+static ret_code_t environmental_trigger_measurement(void);
 
 static int8_t user_spi_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
 {
-    uint32_t ret;
-    uint8_t receive_data[128] = {0};
+    /* Address byte out, then exactly len bytes clocked straight into the driver's buffer */
+    spi_segment_t const segments[] =
+    {
+        { .p_tx = &reg_addr, .p_rx = NULL,     .length = 1            },
+        { .p_tx = NULL,      .p_rx = reg_data, .length = (uint8_t)len }
+    };
 
-    receive_data[0] = reg_addr;
+    UNUSED_PARAMETER(dev_id);
 
-    ret = env_peripherals_spi_rx(receive_data, len + 1);
-    memcpy(reg_data, &receive_data[2], len);
+    /* A segment, like an nrf_drv_spi transfer, counts at most 255 bytes */
+    if (len > UINT8_MAX)
+    {
+        return BME680_E_COM_FAIL;
+    }
 
-    return ret;
+    return (NRF_SUCCESS == env_peripherals_spi_xfer(segments, ARRAY_SIZE(segments))) ? BME680_OK : BME680_E_COM_FAIL;
 }
 
 
 static int8_t user_spi_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
 {
-    uint8_t transmit_data[128] = {0};
+    spi_segment_t const segments[] =
+    {
+        { .p_tx = &reg_addr, .p_rx = NULL, .length = 1            },
+        { .p_tx = reg_data,  .p_rx = NULL, .length = (uint8_t)len }
+    };
 
-    transmit_data[0] = reg_addr;
-    memcpy(&transmit_data[1], reg_data, len);
+    UNUSED_PARAMETER(dev_id);
 
-    return env_peripherals_spi_tx(transmit_data, len + 1);
+    if (len > UINT8_MAX)
+    {
+        return BME680_E_COM_FAIL;
+    }
+
+    return (NRF_SUCCESS == env_peripherals_spi_xfer(segments, ARRAY_SIZE(segments))) ? BME680_OK : BME680_E_COM_FAIL;
 }
 
 
@@ -47,28 +131,312 @@ static void user_delay_ms(uint32_t delay_time_ms)
 }
 
 
-static void environmental_comm_polling_handle(void)
+/**@brief Sensor scheduler start handler, starts a forced-mode conversion.
+ *
+ * @details The sensor is left converting on its own, the CPU goes back to sleep in
+ *          nrf_pwr_mgmt_run() and the scheduler calls environmental_read_sensor_data()
+ *          once the TPHG duration has elapsed.
+ */
+static ret_code_t environmental_trigger_measurement(void)
+{
+    if (ENV_STATE_IDLE != m_env_state)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    APP_ERROR_CHECK(bme680_set_sensor_mode(&m_env_dev));
+
+    m_env_state = ENV_STATE_MEASURING;
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Write what changed in the heater set-up and fetch the next conversion that much later.
+ *
+ * @param[in] settings  Other settings already changed in m_env_dev, written along.
+ */
+static void environmental_heater_config(bool enable, uint8_t step, uint8_t settings)
+{
+    uint16_t meas_period;
+    uint8_t  run_gas  = enable ? BME680_ENABLE_GAS_MEAS : BME680_DISABLE_GAS_MEAS;
+
+    if (run_gas != m_env_dev.gas_sett.run_gas)
+    {
+        m_env_dev.gas_sett.run_gas = run_gas;
+        settings |= BME680_RUN_GAS_SEL;
+    }
+
+    if (enable &&
+        ((m_profile[step].temperature != m_env_dev.gas_sett.heatr_temp) ||
+         (m_profile[step].duration != m_env_dev.gas_sett.heatr_dur)))
+    {
+        m_env_dev.gas_sett.heatr_temp = m_profile[step].temperature;
+        m_env_dev.gas_sett.heatr_dur  = m_profile[step].duration;
+        settings |= BME680_GAS_MEAS_SEL;
+    }
+
+    if (0 == settings)
+    {
+        return;
+    }
+
+    APP_ERROR_CHECK(bme680_set_sensor_settings(settings, &m_env_dev));
+
+    bme680_get_profile_dur(&meas_period, &m_env_dev);
+    sensor_scheduler_latency_set(m_env_job_id, APP_TIMER_TICKS(meas_period + 1));
+}
+
+
+/**@brief Heater on time of one scan. */
+static uint32_t environmental_profile_duration(void)
+{
+    uint32_t duration = 0;
+
+    for (uint8_t i = 0; i < m_profile_steps; i++)
+    {
+        duration += m_profile[i].duration;
+    }
+
+    return duration;
+}
+
+
+/**@brief Turn a complete scan into features against the running baseline.
+ *
+ * @details Ratios and slopes are in 1/ENV_GAS_FEATURE_ONE. A slope is the change from the
+ *          previous step relative to the coolest step, so it does not depend on how clean the
+ *          air is overall.
+ */
+static void environmental_scan_features(void)
+{
+    env_gas_scan_t * p_scan = &m_scan;
+    int64_t          ratio;
+    int64_t          slope;
+
+    p_scan->steps = m_profile_steps;
+
+    for (uint8_t i = 0; i < m_profile_steps; i++)
+    {
+        if (0 == p_scan->sequence)
+        {
+            m_baseline[i] = m_scan_resistance[i];
+        }
+        else
+        {
+            m_baseline[i] += ((int64_t)m_scan_resistance[i] - m_baseline[i]) / (1 << ENV_GAS_BASELINE_SHIFT);
+        }
+
+        ratio = ((int64_t)m_scan_resistance[i] * ENV_GAS_FEATURE_ONE) / MAX(m_baseline[i], 1);
+        slope = (i == 0) ? 0 : (((int64_t)m_scan_resistance[i] - m_scan_resistance[i - 1]) * ENV_GAS_FEATURE_ONE)
+                               / MAX(m_scan_resistance[0], 1);
+
+        p_scan->resistance[i]     = m_scan_resistance[i];
+        p_scan->baseline_ratio[i] = (uint16_t)MIN(ratio, UINT16_MAX);
+        p_scan->slope[i]          = (int16_t)MAX(MIN(slope, INT16_MAX), INT16_MIN);
+    }
+
+    p_scan->sequence++;
+}
+
+
+/**@brief Collect one step, start the next one right away, the scheduler fetches it as usual.
+ *
+ * @return true while the scan goes on.
+ */
+static bool environmental_scan_step(void)
+{
+    if (((m_env_data.status & (BME680_GASM_VALID_MSK | BME680_HEAT_STAB_MSK)) == (BME680_GASM_VALID_MSK | BME680_HEAT_STAB_MSK)) &&
+        (m_env_dev.gas_sett.heatr_temp == m_profile[m_scan_step].temperature))
+    {
+        m_scan_resistance[m_scan_step] = m_env_data.gas_resistance;
+    }
+    else
+    {
+        /* Unstable, or heated for a profile changed since the scan began */
+        m_scan_ok = false;
+    }
+
+    if (++m_scan_step < m_profile_steps)
+    {
+        environmental_heater_config(true, m_scan_step, 0);
+
+        if (NRF_SUCCESS == sensor_scheduler_job_run(m_env_job_id))
+        {
+            return true;
+        }
+
+        m_scan_ok = false;
+    }
+
+    return false;
+}
+
+
+/**@brief Oversampling setting of a channel in m_env_dev. */
+static uint8_t * environmental_oversampling(env_channel_t channel)
+{
+    switch (channel)
+    {
+        case ENV_CHANNEL_TEMPERATURE:
+            return &m_env_dev.tph_sett.os_temp;
+
+        case ENV_CHANNEL_PRESSURE:
+            return &m_env_dev.tph_sett.os_pres;
+
+        default:
+            return &m_env_dev.tph_sett.os_hum;
+    }
+}
+
+
+/**@brief Track the noise of every channel and step its oversampling towards the resolution target.
+ *
+ * @details The noise is taken from the change between two readings rather than from the readings
+ *          themselves, so the slow drift of the room does not count: for white noise the mean square
+ *          change is twice the variance. Doubling the oversampling halves the variance, the estimate
+ *          is scaled along so the next decision only waits for it to confirm.
+ *
+ * @return Settings to write, BME680_OST_SEL, BME680_OSP_SEL and BME680_OSH_SEL.
+ */
+static uint8_t environmental_oversampling_adapt(void)
 {
-    if (ENVIRONMENTAL_TWI_PROCESS_DATA_PERIOD <= environmental_spi_time)
+    static const uint8_t settings_sel[ENV_CHANNEL_COUNT] = { BME680_OST_SEL, BME680_OSP_SEL, BME680_OSH_SEL };
+    int32_t const        readings[ENV_CHANNEL_COUNT]     = { m_env_data.temperature, (int32_t)m_env_data.pressure, (int32_t)m_env_data.humidity };
+    uint8_t              settings = 0;
+
+    for (uint8_t channel = 0; channel < ENV_CHANNEL_COUNT; channel++)
     {
-        environmental_read_sensor_data();
-        environmental_spi_time = 0;
+        env_noise_t * p_noise = &m_noise[channel];
+        uint8_t     * p_os    = environmental_oversampling((env_channel_t)channel);
+        int64_t       diff    = (int64_t)readings[channel] - p_noise->last;
+        uint64_t      variance;
+        uint64_t      target;
+
+        p_noise->last = readings[channel];
+
+        if (0 == p_noise->cycles)
+        {
+            /* Nothing to compare the first reading with */
+            p_noise->cycles = 1;
+            continue;
+        }
+
+        if (1 == p_noise->cycles)
+        {
+            p_noise->diff_power = (uint64_t)(diff * diff) << ENV_NOISE_FRACTION_BITS;
+        }
+        else
+        {
+            p_noise->diff_power += (int64_t)(((uint64_t)(diff * diff) << ENV_NOISE_FRACTION_BITS) - p_noise->diff_power)
+                                   / (1 << ENV_NOISE_SHIFT);
+        }
+
+        if (p_noise->cycles < UINT8_MAX)
+        {
+            p_noise->cycles++;
+        }
+
+        if (p_noise->cycles <= ENV_NOISE_SETTLE_CYCLES)
+        {
+            continue;
+        }
+
+        variance = p_noise->diff_power / 2;
+        target   = ((uint64_t)p_noise->resolution * p_noise->resolution) << ENV_NOISE_FRACTION_BITS;
+
+        if ((0 != p_noise->resolution) && (variance > target) && (*p_os < BME680_OS_16X))
+        {
+            (*p_os)++;
+            p_noise->diff_power /= 2;
+        }
+        else if (((0 == p_noise->resolution) || (4 * variance <= target)) && (*p_os > BME680_OS_1X))
+        {
+            /* Half the target leaves margin for the doubled variance, it does not flip right back */
+            (*p_os)--;
+            p_noise->diff_power *= 2;
+        }
+        else
+        {
+            continue;
+        }
+
+        p_noise->cycles = 2;
+        settings |= settings_sel[channel];
     }
+
+    return settings;
 }
 
 
-static void environmental_timer_event_handler(void)
+/**@brief Account for the cycle just fetched and decide whether the next one heats.
+ *
+ * @details Decided here rather than in the start handler, so the scheduler already paces the
+ *          next start with the latency of the cycle it will be.
+ */
+static void environmental_gas_plan(void)
 {
-    if (0xFFFF != environmental_spi_time)
+    env_gas_policy_cfg_t const * p_policy = &m_gas_policies[m_gas_policy];
+    bool                         due;
+
+    if (BME680_ENABLE_GAS_MEAS == m_env_dev.gas_sett.run_gas)
+    {
+        if (environmental_scan_step())
+        {
+            return;
+        }
+
+        m_gas_stats.heated_cycles++;
+        m_scan_step = 0;
+
+        if (m_scan_ok)
+        {
+            environmental_scan_features();
+
+            m_gas_resistance  = m_scan_resistance[m_profile_steps - 1];
+            m_gas_temperature = m_env_data.temperature;
+            m_gas_humidity    = m_env_data.humidity;
+            m_gas_valid       = true;
+
+            iaq_update(m_gas_resistance, m_gas_humidity, NULL);
+        }
+
+        m_gas_age = 0;
+    }
+    else
+    {
+        m_gas_stats.skipped_cycles++;
+        m_gas_stats.heater_saved_ms += environmental_profile_duration();
+    }
+
+    if (m_gas_age < UINT8_MAX)
+    {
+        m_gas_age++;
+    }
+
+    due = !m_gas_valid ||
+          (m_gas_age >= p_policy->interval) ||
+          ((uint32_t)abs(m_env_data.temperature - m_gas_temperature) >= p_policy->temperature_delta) ||
+          ((uint32_t)abs((int32_t)(m_env_data.humidity - m_gas_humidity)) >= p_policy->humidity_delta);
+
+    if (due)
     {
-        environmental_spi_time++;
+        /* The heater resistance target is computed for the ambient temperature */
+        m_env_dev.amb_temp = m_env_data.temperature / 100;
+        m_scan_step        = 0;
+        m_scan_ok          = true;
     }
+
+    /* Between two cycles only, the steps of a scan share one set-up */
+    environmental_heater_config(due, 0, environmental_oversampling_adapt());
 }
 
 
 void environmental_init(void)
 {
     uint8_t set_required_settings;
+    uint16_t meas_period;
+    sensor_scheduler_job_t env_job;
 
     m_env_dev.dev_id = 0;
     m_env_dev.intf = BME680_SPI_INTF;
@@ -82,17 +450,21 @@ void environmental_init(void)
 
     APP_ERROR_CHECK(bme680_init(&m_env_dev));
 
-    /* Set the temperature, pressure and humidity settings */
+    /* Set the temperature, pressure and humidity settings, the starting point of the adaptation */
     m_env_dev.tph_sett.os_hum = BME680_OS_4X;
     m_env_dev.tph_sett.os_temp = BME680_OS_4X;
     m_env_dev.tph_sett.os_pres = BME680_OS_4X;
     m_env_dev.tph_sett.filter = BME680_FILTER_SIZE_3;
 
     /* Set the remaining gas sensor settings and link the heating profile */
+    memcpy(m_profile, m_default_profile, sizeof(m_default_profile));
+    m_profile_steps = ARRAY_SIZE(m_default_profile);
+    m_scan_ok = true;
+
     m_env_dev.gas_sett.run_gas = BME680_ENABLE_GAS_MEAS;
-    /* Create a ramp heat waveform in 3 steps */
-    m_env_dev.gas_sett.heatr_temp = 320; /* degree Celsius */
-    m_env_dev.gas_sett.heatr_dur = 120; /* milliseconds */
+    /* The first scan step, the others are written between the conversions of a scan */
+    m_env_dev.gas_sett.heatr_temp = m_profile[0].temperature; /* degree Celsius */
+    m_env_dev.gas_sett.heatr_dur = m_profile[0].duration; /* milliseconds */
 
     /* Select the power mode */
     /* Must be set before writing the sensor configuration */
@@ -104,46 +476,136 @@ void environmental_init(void)
     /* Set the desired sensor configuration */
     APP_ERROR_CHECK(bme680_set_sensor_settings(set_required_settings, &m_env_dev));
 
-    /* Set the power mode */
-    APP_ERROR_CHECK(bme680_set_sensor_mode(&m_env_dev));
+    /* The TPHG duration only changes with the settings, the scheduler waits exactly that long */
+    bme680_get_profile_dur(&meas_period, &m_env_dev);
 
-    peripherals_assign_comm_handle(ENVIRONMENTAL_COMM, environmental_comm_polling_handle);
-    peripherals_assign_comm_handle(TIMER_ENVIRONMENTAL, environmental_timer_event_handler);
+    env_job.start_handler = environmental_trigger_measurement;
+    env_job.fetch_handler = environmental_read_sensor_data;
+    env_job.period        = SENSOR_SCHEDULER_PERIOD_PUBLISH;
+    env_job.latency       = APP_TIMER_TICKS(meas_period + 1);
+    env_job.jitter        = ENVIRONMENTAL_SAMPLE_JITTER;
 
-    m_env_dev.delay_ms(10);
+    APP_ERROR_CHECK(sensor_scheduler_register(&env_job, &m_env_job_id));
 }
 
 
-void environmental_read_sensor_data(void)
+ret_code_t environmental_read_sensor_data(void)
 {
-    APP_ERROR_CHECK(bme680_get_sensor_data(&m_env_data, &m_env_dev));
-    
-    /* Trigger the next measurement if you would like to read data out continuously */
-    if (m_env_dev.power_mode == BME680_FORCED_MODE)
+    if (ENV_STATE_MEASURING != m_env_state)
     {
-        APP_ERROR_CHECK(bme680_set_sensor_mode(&m_env_dev));
+        return NRF_ERROR_INVALID_STATE;
     }
+
+    APP_ERROR_CHECK(bme680_get_sensor_data(&m_env_data, &m_env_dev));
+
+    /* Idle first, the plan may start the next step of a scan */
+    m_env_state = ENV_STATE_IDLE;
+
+    environmental_gas_plan();
+
+    return NRF_SUCCESS;
+}
+
+uint32_t environmental_sample_age_get(void)
+{
+    return sensor_scheduler_sample_age_get(m_env_job_id);
 }
 
+
 void environmental_get_data(env_data_t *env_data)
 {
-    float res;
-    
     float temperature_f;
     float pressure_f;
     float altitude_f;
 
-    temperature_f = ((float)m_env_data.temperature) / 100.0;
-    pressure_f = ((float)m_env_data.pressure) / 100.0;
+    temperature_f = ((float)m_env_data.temperature) / 100.0f;
+    pressure_f = ((float)m_env_data.pressure) / 100.0f;
 
-    res = pressure_f / 1013.96;
-    res = pow(res, 0.19022);
-    res = 1.0 - res;
-    altitude_f = res * ((temperature_f + 273.15) / 0.0065);
+    altitude_f = altitude_get(pressure_f, temperature_f);
 
     env_data->temperature     = m_env_data.temperature;
     env_data->humidity        = m_env_data.humidity;
-    env_data->gas_resistance  = m_env_data.gas_resistance;
+    env_data->gas_resistance  = m_gas_resistance;
     env_data->pressure        = m_env_data.pressure;
     env_data->altitude        = altitude_f * 100;
 }
+
+
+void environmental_gas_policy_set(env_gas_policy_t policy)
+{
+    if (policy < ENV_GAS_POLICY_COUNT)
+    {
+        m_gas_policy = policy;
+    }
+}
+
+
+void environmental_gas_stats_get(env_gas_stats_t * p_stats)
+{
+    *p_stats = m_gas_stats;
+}
+
+
+ret_code_t environmental_gas_profile_set(env_gas_step_t const * p_steps, uint8_t step_count)
+{
+    ret_code_t err_code = NRF_SUCCESS;
+
+    if (NULL == p_steps)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if ((0 == step_count) || (step_count > ENV_GAS_SCAN_MAX_STEPS))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    if ((0 != m_scan_step) || ((ENV_STATE_IDLE != m_env_state) && (BME680_ENABLE_GAS_MEAS == m_env_dev.gas_sett.run_gas)))
+    {
+        err_code = NRF_ERROR_BUSY;
+    }
+    else
+    {
+        memcpy(m_profile, p_steps, step_count * sizeof(env_gas_step_t));
+        m_profile_steps = step_count;
+
+        /* Features of another profile do not compare, start over */
+        m_scan.sequence = 0;
+        m_gas_valid     = false;
+        iaq_reset();
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+void environmental_resolution_set(env_channel_t channel, uint32_t resolution)
+{
+    if (channel < ENV_CHANNEL_COUNT)
+    {
+        m_noise[channel].resolution = resolution;
+    }
+}
+
+
+uint8_t environmental_oversampling_get(env_channel_t channel)
+{
+    if (channel >= ENV_CHANNEL_COUNT)
+    {
+        return BME680_OS_NONE;
+    }
+
+    return *environmental_oversampling(channel);
+}
+
+
+void environmental_gas_scan_get(env_gas_scan_t * p_scan)
+{
+    CRITICAL_REGION_ENTER();
+    *p_scan = m_scan;
+    CRITICAL_REGION_EXIT();
+}
@@ -6,6 +6,7 @@
 #include "bme680.h"
 #include "bme680_defs.h"
 #include "Miscellaneous.h"
+#include "sdk_errors.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,9 +21,99 @@ typedef struct
     uint32_t altitude;
 } env_data_t;
 
+/**@brief How often the gas heater runs, fresher air quality readings against battery life. */
+typedef enum
+{
+    ENV_GAS_POLICY_FRESH = 0,           /**< Every cycle. */
+    ENV_GAS_POLICY_BALANCED,            /**< Every 6th cycle, or after a 0.5 degree Celsius or 3 %RH change. */
+    ENV_GAS_POLICY_SAVER,               /**< Every 36th cycle, or after a 1.5 degree Celsius or 8 %RH change. */
+    ENV_GAS_POLICY_COUNT
+} env_gas_policy_t;
+
+#define ENV_GAS_SCAN_MAX_STEPS          10          /**< Heater set-points the BME680 holds. */
+
+/**@brief One heater set-point of a gas scan. */
+typedef struct
+{
+    uint16_t temperature;               /**< Heater target, degree Celsius. */
+    uint16_t duration;                  /**< Heating time before the resistance is sampled, ms. */
+} env_gas_step_t;
+
+/**@brief Resistance vector of the latest complete scan and the features extracted from it. */
+typedef struct
+{
+    uint32_t sequence;                                  /**< Scans completed with this profile. */
+    uint8_t  steps;                                     /**< Valid entries in the arrays. */
+    uint32_t resistance[ENV_GAS_SCAN_MAX_STEPS];        /**< Ohm. */
+    uint16_t baseline_ratio[ENV_GAS_SCAN_MAX_STEPS];    /**< Resistance over its slow running average, 1/4096. */
+    int16_t  slope[ENV_GAS_SCAN_MAX_STEPS];             /**< Change from the previous step over the first step, 1/4096. */
+} env_gas_scan_t;
+
+/**@brief Channels the oversampling adapts on. */
+typedef enum
+{
+    ENV_CHANNEL_TEMPERATURE = 0,
+    ENV_CHANNEL_PRESSURE,
+    ENV_CHANNEL_HUMIDITY,
+    ENV_CHANNEL_COUNT
+} env_channel_t;
+
+#define ENV_RESOLUTION_TEMPERATURE_DEFAULT  2       /**< 0.02 degree Celsius. */
+#define ENV_RESOLUTION_PRESSURE_DEFAULT     2       /**< 2 Pa, about 17 cm of altitude. */
+#define ENV_RESOLUTION_HUMIDITY_DEFAULT     50      /**< 0.05 %RH. */
+
+typedef struct
+{
+    uint32_t heated_cycles;             /**< Cycles that measured gas. */
+    uint32_t skipped_cycles;            /**< Cycles that measured T, P and H only. */
+    uint32_t heater_saved_ms;           /**< Heater on time the skipped cycles saved, a whole scan each. */
+} env_gas_stats_t;
+
 void environmental_init(void);
-void environmental_read_sensor_data(void);
+ret_code_t environmental_read_sensor_data(void);
 void environmental_get_data(env_data_t *env_data);
+uint32_t environmental_sample_age_get(void);
+
+/**@brief Function for choosing when the gas heater runs, the default is ENV_GAS_POLICY_BALANCED.
+ *
+ * @details T, P and H are measured every cycle whatever the policy. In between two heated cycles
+ *          environmental_get_data() keeps reporting the last valid gas resistance. Takes effect
+ *          from the cycle after the next one.
+ */
+void environmental_gas_policy_set(env_gas_policy_t policy);
+
+/**@brief Function for reading the heater statistics since start up. */
+void environmental_gas_stats_get(env_gas_stats_t * p_stats);
+
+/**@brief Function for changing the heater profile a gas scan steps through.
+ *
+ * @details A heated cycle runs every step back to back, each a forced conversion of its own
+ *          started from the fetch of the one before, so the CPU sleeps in between. The default
+ *          profile is 200, 250, 300 and 350 degree Celsius, 100 ms each. A new profile also
+ *          restarts the baseline.
+ *
+ * @retval NRF_ERROR_BUSY if a scan is in progress.
+ */
+ret_code_t environmental_gas_profile_set(env_gas_step_t const * p_steps, uint8_t step_count);
+
+/**@brief Function for setting the noise a consumer accepts on a channel.
+ *
+ * @details The noise is the standard deviation of a reading, in the units of env_data_t: 0.01 degree
+ *          Celsius, Pa or 0.001 %RH. The oversampling of the channel is halved while the measured
+ *          noise stays under half the target, and doubled once it goes over, from 1x to 16x. A
+ *          target of 0 means nobody needs the channel precise, it then runs at 1x. Takes effect
+ *          between two cycles, never in the middle of a gas scan.
+ */
+void environmental_resolution_set(env_channel_t channel, uint32_t resolution);
+
+/**@brief Function for reading the oversampling a channel currently runs at, BME680_OS_1X to BME680_OS_16X. */
+uint8_t environmental_oversampling_get(env_channel_t channel);
+
+/**@brief Function for reading the latest complete scan.
+ *
+ * @details Every valid scan also feeds its last step to the IAQ engine, see iaq_result_get().
+ */
+void environmental_gas_scan_get(env_gas_scan_t * p_scan);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,146 @@
+#include <string.h>
+
+#include "app_util_platform.h"
+
+#include "iaq.h"
+
+#define IAQ_STABILIZE_UPDATES           10          /**< Readings discarded while the metal oxide settles after power up. */
+#define IAQ_BASELINE_RISE_SHIFT         4           /**< Cleaner air is taken up within 16 updates. */
+#define IAQ_BASELINE_FALL_SHIFT         10          /**< Time constant of 1024 updates towards dirtier air. */
+#define IAQ_BASELINE_FRAC_BITS          8
+#define IAQ_HUMIDITY_REFERENCE          40000       /**< Humidity the resistance is compensated to, 0.001 %RH. */
+#define IAQ_HUMIDITY_SLOPE              983         /**< Resistance change per %RH, 1/65536, about 1.5 %. */
+#define IAQ_HUMIDITY_FACTOR_MIN         16384       /**< Compensation is never below a quarter. */
+#define IAQ_CLEAN                       25          /**< Index at the baseline. */
+#define IAQ_RATIO_WORST                 (IAQ_RATIO_ONE / 4) /**< Ratio mapped to IAQ_MAX. */
+#define IAQ_RATIO_BEST                  (IAQ_RATIO_ONE + IAQ_RATIO_ONE / 4) /**< Ratio mapped to 0. */
+#define IAQ_ECO2_CLEAN                  400         /**< Outdoor CO2, ppm, at an index of 0. */
+#define IAQ_ECO2_PER_INDEX              8           /**< ppm per index point, 4400 ppm at IAQ_MAX. */
+#define IAQ_BVOC_PER_INDEX              20          /**< ppb per index point, 0.5 ppm at the baseline. */
+#define IAQ_SETTLED_UPDATES             (IAQ_STABILIZE_UPDATES + (1UL << IAQ_BASELINE_FALL_SHIFT))
+
+static uint64_t     m_baseline;                     /**< Compensated clean air resistance, 1/256 Ohm. */
+static uint32_t     m_updates;
+static uint16_t     m_ratio_min = UINT16_MAX;       /**< Lowest ratio since the baseline settled. */
+static iaq_result_t m_result;
+
+
+/**@brief Scale the resistance to what it would be at IAQ_HUMIDITY_REFERENCE. */
+static uint32_t humidity_compensate(uint32_t gas_resistance, uint32_t humidity)
+{
+    int64_t factor = 65536 + ((int64_t)IAQ_HUMIDITY_SLOPE * ((int32_t)humidity - IAQ_HUMIDITY_REFERENCE)) / 1000;
+
+    if (factor < IAQ_HUMIDITY_FACTOR_MIN)
+    {
+        factor = IAQ_HUMIDITY_FACTOR_MIN;
+    }
+
+    return (uint32_t)MIN(((uint64_t)gas_resistance * (uint64_t)factor) >> 16, UINT32_MAX);
+}
+
+
+/**@brief Map the ratio to the index, linear from IAQ_RATIO_BEST to IAQ_RATIO_WORST. */
+static uint16_t ratio_to_iaq(uint16_t ratio)
+{
+    if (ratio >= IAQ_RATIO_BEST)
+    {
+        return 0;
+    }
+
+    if (ratio <= IAQ_RATIO_WORST)
+    {
+        return IAQ_MAX;
+    }
+
+    if (ratio >= IAQ_RATIO_ONE)
+    {
+        return (uint16_t)(((uint32_t)(IAQ_RATIO_BEST - ratio) * IAQ_CLEAN) / (IAQ_RATIO_BEST - IAQ_RATIO_ONE));
+    }
+
+    return (uint16_t)(IAQ_CLEAN + ((uint32_t)(IAQ_RATIO_ONE - ratio) * (IAQ_MAX - IAQ_CLEAN)) / (IAQ_RATIO_ONE - IAQ_RATIO_WORST));
+}
+
+
+static iaq_accuracy_t accuracy_get(void)
+{
+    if (m_updates <= IAQ_STABILIZE_UPDATES)
+    {
+        return IAQ_ACCURACY_STABILIZING;
+    }
+
+    if (m_updates <= IAQ_SETTLED_UPDATES)
+    {
+        return IAQ_ACCURACY_LOW;
+    }
+
+    return (m_ratio_min <= IAQ_RATIO_ONE / 2) ? IAQ_ACCURACY_HIGH : IAQ_ACCURACY_MEDIUM;
+}
+
+
+void iaq_reset(void)
+{
+    m_baseline  = 0;
+    m_updates   = 0;
+    m_ratio_min = UINT16_MAX;
+    memset(&m_result, 0, sizeof(m_result));
+}
+
+
+void iaq_update(uint32_t gas_resistance, uint32_t humidity, iaq_result_t * p_result)
+{
+    uint64_t compensated = (uint64_t)humidity_compensate(gas_resistance, humidity) << IAQ_BASELINE_FRAC_BITS;
+    uint64_t ratio;
+
+    if (m_updates < UINT32_MAX)
+    {
+        m_updates++;
+    }
+
+    if ((m_updates <= IAQ_STABILIZE_UPDATES) || (0 == m_baseline))
+    {
+        m_baseline = compensated;
+    }
+    else if (compensated > m_baseline)
+    {
+        m_baseline += (compensated - m_baseline) >> IAQ_BASELINE_RISE_SHIFT;
+    }
+    else
+    {
+        m_baseline -= (m_baseline - compensated) >> IAQ_BASELINE_FALL_SHIFT;
+    }
+
+    ratio = (m_baseline > 0) ? (compensated * IAQ_RATIO_ONE) / m_baseline : IAQ_RATIO_ONE;
+
+    m_result.ratio = (uint16_t)MIN(ratio, UINT16_MAX);
+
+    // Before the accuracy, the reading that completes the range already counts.
+    if (m_updates > IAQ_SETTLED_UPDATES)
+    {
+        m_ratio_min = MIN(m_ratio_min, m_result.ratio);
+    }
+
+    m_result.accuracy = accuracy_get();
+
+    m_result.iaq  = ratio_to_iaq(m_result.ratio);
+    m_result.eco2 = IAQ_ECO2_CLEAN + m_result.iaq * IAQ_ECO2_PER_INDEX;
+    m_result.bvoc = m_result.iaq * IAQ_BVOC_PER_INDEX;
+
+    if (NULL != p_result)
+    {
+        *p_result = m_result;
+    }
+}
+
+
+bool iaq_result_get(iaq_result_t * p_result)
+{
+    bool valid;
+
+    // The result is updated from the sensor fetch, in interrupt context.
+    CRITICAL_REGION_ENTER();
+    *p_result = m_result;
+    valid     = (m_updates > 0);
+    CRITICAL_REGION_EXIT();
+
+    return valid;
+}
@@ -0,0 +1,58 @@
+#ifndef _IAQ_H_
+#define _IAQ_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IAQ_RATIO_ONE                   4096        /**< Compensated resistance equal to the baseline. */
+#define IAQ_MAX                         500
+
+/**@brief How far the result can be trusted, in the order the engine goes through. */
+typedef enum
+{
+    IAQ_ACCURACY_STABILIZING = 0,       /**< Sensor warming up, the baseline restarts on every update. */
+    IAQ_ACCURACY_LOW,                   /**< Baseline younger than one time constant. */
+    IAQ_ACCURACY_MEDIUM,                /**< Baseline settled, not yet seen polluted air. */
+    IAQ_ACCURACY_HIGH                   /**< Baseline settled and the ratio has covered a 2:1 range. */
+} iaq_accuracy_t;
+
+typedef struct
+{
+    uint16_t iaq;                       /**< Index, 0 to IAQ_MAX, 25 at the baseline. */
+    uint16_t eco2;                      /**< CO2 equivalent, ppm. */
+    uint16_t bvoc;                      /**< Breath VOC equivalent, ppb. */
+    uint16_t ratio;                     /**< Compensated resistance over the baseline, 1/IAQ_RATIO_ONE. */
+    uint8_t  accuracy;                  /**< See @ref iaq_accuracy_t. */
+} iaq_result_t;
+
+/**@brief Function for starting over, e.g. after the heater set-point changed. */
+void iaq_reset(void);
+
+/**@brief Function for feeding one gas reading to the engine.
+ *
+ * @details Constant time, integer arithmetic only. The baseline is an IIR that rises within
+ *          16 updates and falls with a time constant of 1024, so it tracks the cleanest air seen
+ *          rather than the average. Resistance drops in humid air, it is compensated to 40 %RH
+ *          first.
+ *
+ * @param[in]  gas_resistance  Heat stable gas resistance, Ohm.
+ * @param[in]  humidity        Relative humidity the reading was taken at, 0.001 %RH.
+ * @param[out] p_result        New result. Can be NULL.
+ */
+void iaq_update(uint32_t gas_resistance, uint32_t humidity, iaq_result_t * p_result);
+
+/**@brief Function for reading the latest result.
+ *
+ * @return true if at least one reading was fed since the last reset.
+ */
+bool iaq_result_get(iaq_result_t * p_result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IAQ_H_ */
@@ -0,0 +1,480 @@
+#include <string.h>
+
+#include "app_util_platform.h"
+#include "app_timer.h"
+#include "app_error.h"
+#include "nrf_log.h"
+
+#include "sensor_scheduler.h"
+
+#define SENSOR_SCHEDULER_MAX_DELAY      (APP_TIMER_MAX_CNT_VAL / 2)     /**< Longest single wait, keeps the tick count extension unambiguous. */
+#define SENSOR_SCHEDULER_HOUR           APP_TIMER_TICKS(3600000)        /**< Statistics window. */
+
+typedef struct
+{
+    sensor_scheduler_job_t job;
+    uint32_t               start_tick;          /**< Tick of the next start of a periodic job. */
+    uint32_t               fetch_tick;          /**< Tick of the pending fetch, valid while converting. */
+    uint32_t               cycle_tick;          /**< Publish tick the last start of a paced job was for. */
+    uint32_t               sample_tick;         /**< Tick the last result came in. */
+    bool                   converting;          /**< Started, waiting for the fetch. */
+    bool                   has_sample;          /**< sample_tick is valid. */
+} sensor_scheduler_entry_t;
+
+static sensor_scheduler_entry_t   m_entries[SENSOR_SCHEDULER_MAX_JOBS];
+static uint8_t                    m_entry_count;
+static sensor_scheduler_publish_t m_publish_handler;
+static uint32_t                   m_publish_period;
+static uint32_t                   m_publish_tick; /**< Tick of the next publish. */
+static uint32_t                   m_now;          /**< Ticks since sensor_scheduler_start(), 32 bits wide. */
+static uint32_t                   m_last_cnt;     /**< RTC counter when m_now was last brought up to date. */
+static bool                       m_started;
+static bool                       m_in_handler;   /**< The timer handler re-arms when it returns. */
+static bool                       m_armed;        /**< The timer is running, until m_wakeup_tick. */
+static uint32_t                   m_wakeup_tick;  /**< Tick the armed timer expires at. */
+static uint32_t                   m_hour_start;   /**< Tick the current statistics hour began. */
+static uint32_t                   m_hour_wakeups;
+static uint32_t                   m_hour_runs;
+static sensor_scheduler_stats_t   m_stats;
+
+APP_TIMER_DEF(m_scheduler_timer_id);                                            /**< The only wakeup of every sensor job. */
+
+
+/**@brief Extend the 24-bit RTC counter to a 32-bit tick count. */
+static uint32_t now_get(void)
+{
+    uint32_t cnt = app_timer_cnt_get();
+
+    m_now     += app_timer_cnt_diff_compute(cnt, m_last_cnt);
+    m_last_cnt = cnt;
+
+    return m_now;
+}
+
+
+static bool entry_is_paced(sensor_scheduler_entry_t const * p_entry)
+{
+    return (SENSOR_SCHEDULER_PERIOD_PUBLISH == p_entry->job.period);
+}
+
+
+/**@brief Tick the next start of the job is aimed at, a paced job finishes converting at the publish. */
+static uint32_t entry_start_target(sensor_scheduler_entry_t const * p_entry)
+{
+    uint32_t publish_tick;
+
+    if (!entry_is_paced(p_entry))
+    {
+        return p_entry->start_tick;
+    }
+
+    publish_tick = m_publish_tick;
+    if (p_entry->cycle_tick == publish_tick)
+    {
+        // Already acquired for this publish, aim at the one after.
+        publish_tick += m_publish_period;
+    }
+
+    return publish_tick - p_entry->job.latency;
+}
+
+
+/**@brief Last tick at which the job can still run.
+ *
+ * @details A paced job may only start early, a late start would miss the publish.
+ */
+static uint32_t entry_deadline(sensor_scheduler_entry_t const * p_entry)
+{
+    if (p_entry->converting)
+    {
+        return p_entry->fetch_tick + p_entry->job.jitter;
+    }
+
+    return entry_start_target(p_entry) + (entry_is_paced(p_entry) ? 0 : p_entry->job.jitter);
+}
+
+
+/**@brief A fetch is never early, the conversion must be over. */
+static bool entry_fetch_due(sensor_scheduler_entry_t const * p_entry, uint32_t now)
+{
+    return p_entry->converting && ((int32_t)(now - p_entry->fetch_tick) >= 0);
+}
+
+
+/**@brief A start may be early by up to its jitter when the CPU is awake anyway. */
+static bool entry_start_due(sensor_scheduler_entry_t const * p_entry, uint32_t now)
+{
+    return !p_entry->converting &&
+           ((int32_t)(now - (entry_start_target(p_entry) - p_entry->job.jitter)) >= 0);
+}
+
+
+static ret_code_t entry_start(sensor_scheduler_entry_t * p_entry, uint32_t now)
+{
+    ret_code_t err_code = p_entry->job.start_handler();
+
+    if (NRF_SUCCESS != err_code)
+    {
+        return err_code;
+    }
+
+    if (NULL != p_entry->job.fetch_handler)
+    {
+        p_entry->converting = true;
+        p_entry->fetch_tick = now + p_entry->job.latency;
+    }
+    else
+    {
+        p_entry->sample_tick = now;
+        p_entry->has_sample  = true;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+static void entry_fetch(sensor_scheduler_entry_t * p_entry, uint32_t now)
+{
+    p_entry->converting = false;
+
+    if (NRF_SUCCESS != p_entry->job.fetch_handler())
+    {
+        return;
+    }
+
+    p_entry->sample_tick = now;
+    p_entry->has_sample  = true;
+}
+
+
+/**@brief Tick the publish waits for, the end of any conversion started for it that ran late. */
+static uint32_t publish_deadline(void)
+{
+    uint32_t deadline = m_publish_tick;
+
+    for (uint8_t i = 0; i < m_entry_count; i++)
+    {
+        if (m_entries[i].converting &&
+            entry_is_paced(&m_entries[i]) &&
+            (m_entries[i].cycle_tick == m_publish_tick) &&
+            ((int32_t)(m_entries[i].fetch_tick - deadline) > 0))
+        {
+            deadline = m_entries[i].fetch_tick;
+        }
+    }
+
+    return deadline;
+}
+
+
+/**@brief Arm the timer for the first window to close, the latest wakeup that misses no job.
+ *
+ * @details app_timer_start() ignores a timer that is running already, so an earlier wakeup
+ *          stops it first. A later one leaves it be, the handler re-arms when it fires.
+ */
+static void timer_arm(uint32_t now)
+{
+    int32_t  delay = SENSOR_SCHEDULER_MAX_DELAY;
+    int32_t  entry_delay;
+
+    if (NULL != m_publish_handler)
+    {
+        delay = MIN(delay, (int32_t)(publish_deadline() - now));
+    }
+
+    for (uint8_t i = 0; i < m_entry_count; i++)
+    {
+        entry_delay = (int32_t)(entry_deadline(&m_entries[i]) - now);
+        delay       = MIN(delay, entry_delay);
+    }
+
+    delay = MAX(delay, APP_TIMER_MIN_TIMEOUT_TICKS);
+
+    if (m_armed)
+    {
+        if ((int32_t)(now + delay - m_wakeup_tick) >= 0)
+        {
+            return;
+        }
+
+        APP_ERROR_CHECK(app_timer_stop(m_scheduler_timer_id));
+    }
+
+    APP_ERROR_CHECK(app_timer_start(m_scheduler_timer_id, delay, NULL));
+
+    m_armed       = true;
+    m_wakeup_tick = now + delay;
+}
+
+
+/**@brief Roll the hourly statistics over. */
+static void stats_update(uint32_t now, uint32_t runs)
+{
+    m_stats.wakeups++;
+    m_stats.runs += runs;
+    m_hour_wakeups++;
+    m_hour_runs += runs;
+
+    if ((now - m_hour_start) >= SENSOR_SCHEDULER_HOUR)
+    {
+        m_stats.wakeups_last_hour = m_hour_wakeups;
+        m_stats.runs_last_hour    = m_hour_runs;
+
+        NRF_LOG_INFO("Sensor scheduler: %d wakeups, %d jobs in the last hour", m_hour_wakeups, m_hour_runs);
+
+        m_hour_start  += SENSOR_SCHEDULER_HOUR;
+        m_hour_wakeups = 0;
+        m_hour_runs    = 0;
+    }
+}
+
+
+/**@brief Run every job whose window is open, then sleep until the next window closes.
+ *
+ * @details The stages run in pipeline order: conversion results are fetched, then acquisitions
+ *          are started, which for a job without a fetch handler is the whole sample, and last
+ *          the publish handler encodes and sends what came in.
+ */
+static void scheduler_timeout_handler(void * p_context)
+{
+    sensor_scheduler_entry_t * p_entry;
+    uint32_t                   now  = now_get();
+    uint32_t                   runs = 0;
+
+    UNUSED_PARAMETER(p_context);
+
+    m_in_handler = true;
+    m_armed      = false;
+
+    for (uint8_t i = 0; i < m_entry_count; i++)
+    {
+        p_entry = &m_entries[i];
+
+        if (entry_fetch_due(p_entry, now))
+        {
+            entry_fetch(p_entry, now);
+            runs++;
+        }
+    }
+
+    for (uint8_t i = 0; i < m_entry_count; i++)
+    {
+        p_entry = &m_entries[i];
+
+        if (!entry_start_due(p_entry, now))
+        {
+            continue;
+        }
+
+        if (entry_is_paced(p_entry))
+        {
+            p_entry->cycle_tick = entry_start_target(p_entry) + p_entry->job.latency;
+        }
+        else
+        {
+            p_entry->start_tick += p_entry->job.period;
+            if (entry_start_due(p_entry, now))
+            {
+                // Late by more than a period, e.g. a long flash operation, do not try to catch up.
+                p_entry->start_tick = now + p_entry->job.period;
+            }
+        }
+
+        (void)entry_start(p_entry, now);
+        runs++;
+    }
+
+    if ((NULL != m_publish_handler) && ((int32_t)(now - publish_deadline()) >= 0))
+    {
+        m_publish_handler();
+        runs++;
+
+        m_publish_tick += m_publish_period;
+        if ((int32_t)(now - m_publish_tick) >= 0)
+        {
+            m_publish_tick = now + m_publish_period;
+        }
+    }
+
+    stats_update(now, runs);
+
+    m_in_handler = false;
+
+    timer_arm(now_get());
+}
+
+
+ret_code_t sensor_scheduler_init(void)
+{
+    return app_timer_create(&m_scheduler_timer_id,
+                            APP_TIMER_MODE_SINGLE_SHOT,
+                            scheduler_timeout_handler);
+}
+
+
+ret_code_t sensor_scheduler_register(sensor_scheduler_job_t const * p_job, uint8_t * p_job_id)
+{
+    if ((NULL == p_job) || (NULL == p_job->start_handler) || (NULL == p_job_id))
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if ((SENSOR_SCHEDULER_PERIOD_PUBLISH != p_job->period) &&
+        ((p_job->latency >= p_job->period) ||
+         (p_job->jitter >= p_job->period / 2) ||
+         (p_job->period > SENSOR_SCHEDULER_MAX_DELAY)))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (m_started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (m_entry_count >= SENSOR_SCHEDULER_MAX_JOBS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    memset(&m_entries[m_entry_count], 0, sizeof(m_entries[m_entry_count]));
+    m_entries[m_entry_count].job = *p_job;
+
+    *p_job_id = m_entry_count++;
+
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t sensor_scheduler_publish_set(sensor_scheduler_publish_t publish_handler, uint32_t period)
+{
+    if (NULL == publish_handler)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    if ((period == 0) || (period > SENSOR_SCHEDULER_MAX_DELAY))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (m_started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    m_publish_handler = publish_handler;
+    m_publish_period  = period;
+
+    return NRF_SUCCESS;
+}
+
+
+void sensor_scheduler_latency_set(uint8_t job_id, uint32_t latency)
+{
+    uint32_t limit;
+
+    if (job_id >= m_entry_count)
+    {
+        return;
+    }
+
+    limit = entry_is_paced(&m_entries[job_id]) ? m_publish_period - m_entries[job_id].job.jitter
+                                               : m_entries[job_id].job.period;
+    if (latency < limit)
+    {
+        m_entries[job_id].job.latency = latency;
+    }
+}
+
+
+ret_code_t sensor_scheduler_job_run(uint8_t job_id)
+{
+    ret_code_t err_code;
+    uint32_t   now;
+
+    if (job_id >= m_entry_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    if (!m_started || m_entries[job_id].converting)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    // Job state is shared with the timer handler.
+    CRITICAL_REGION_ENTER();
+
+    now      = now_get();
+    err_code = entry_start(&m_entries[job_id], now);
+    if ((NRF_SUCCESS == err_code) && !m_in_handler)
+    {
+        timer_arm(now);
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+
+uint32_t sensor_scheduler_sample_age_get(uint8_t job_id)
+{
+    uint32_t age = UINT32_MAX;
+
+    if ((job_id < m_entry_count) && m_entries[job_id].has_sample)
+    {
+        CRITICAL_REGION_ENTER();
+        age = now_get() - m_entries[job_id].sample_tick;
+        CRITICAL_REGION_EXIT();
+    }
+
+    return age;
+}
+
+
+ret_code_t sensor_scheduler_start(void)
+{
+    if (m_started)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    for (uint8_t i = 0; i < m_entry_count; i++)
+    {
+        if (entry_is_paced(&m_entries[i]) &&
+            ((NULL == m_publish_handler) ||
+             (m_entries[i].job.latency + m_entries[i].job.jitter >= m_publish_period)))
+        {
+            return NRF_ERROR_INVALID_PARAM;
+        }
+    }
+
+    m_last_cnt   = app_timer_cnt_get();
+    m_now        = 0;
+    m_hour_start = 0;
+    m_started    = true;
+
+    // The first publish leaves every paced job time to convert.
+    m_publish_tick = m_now + m_publish_period;
+
+    // Periodic jobs start together, jobs with related periods then keep sharing wakeups.
+    for (uint8_t i = 0; i < m_entry_count; i++)
+    {
+        m_entries[i].start_tick = m_now + m_entries[i].job.jitter;
+        m_entries[i].cycle_tick = m_now;
+    }
+
+    timer_arm(m_now);
+
+    return NRF_SUCCESS;
+}
+
+
+void sensor_scheduler_stats_get(sensor_scheduler_stats_t * p_stats)
+{
+    CRITICAL_REGION_ENTER();
+    *p_stats = m_stats;
+    CRITICAL_REGION_EXIT();
+}
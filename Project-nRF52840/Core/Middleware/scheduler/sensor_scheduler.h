@@ -0,0 +1,110 @@
+#ifndef _SENSOR_SCHEDULER_H_
+#define _SENSOR_SCHEDULER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sdk_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENSOR_SCHEDULER_MAX_JOBS       4           /**< Sensors that can register a job. */
+#define SENSOR_SCHEDULER_PERIOD_PUBLISH 0           /**< Job period: one acquisition per publish, timed to finish converting right before it. */
+
+/**@brief Starts an acquisition. Anything but NRF_SUCCESS skips the fetch of this period. */
+typedef ret_code_t (*sensor_scheduler_start_t)(void);
+
+/**@brief Collects the result once the conversion latency has elapsed. Anything but NRF_SUCCESS
+ *        means no result was collected, the previous sample and its age are kept. */
+typedef ret_code_t (*sensor_scheduler_fetch_t)(void);
+
+/**@brief Encodes and sends the latest results, the consumer end of the pipeline. */
+typedef void (*sensor_scheduler_publish_t)(void);
+
+typedef struct
+{
+    sensor_scheduler_start_t start_handler;     /**< Called every period, e.g. writes the measure command. */
+    sensor_scheduler_fetch_t fetch_handler;     /**< Called latency ticks after a successful start, NULL if the start handler does everything. */
+    uint32_t                 period;            /**< Ticks between two starts, or SENSOR_SCHEDULER_PERIOD_PUBLISH. */
+    uint32_t                 latency;           /**< Conversion time in ticks, must be shorter than the period. */
+    uint32_t                 jitter;            /**< Ticks a start may move either way, or a fetch may be late, to share a wakeup.
+                                                     A start paced by the publish may only be early. */
+} sensor_scheduler_job_t;
+
+typedef struct
+{
+    uint32_t wakeups;                           /**< Scheduler wakeups since sensor_scheduler_start(). */
+    uint32_t runs;                              /**< Start and fetch handlers run since sensor_scheduler_start(). */
+    uint32_t wakeups_last_hour;                 /**< Wakeups in the last complete hour. */
+    uint32_t runs_last_hour;                    /**< Handlers run in the last complete hour. */
+} sensor_scheduler_stats_t;
+
+/**@brief Function for creating the scheduler timer. app_timer must be initialized. */
+ret_code_t sensor_scheduler_init(void);
+
+/**@brief Function for registering a periodic sensor job.
+ *
+ * @details Jobs are started by sensor_scheduler_start(). Every handler runs in app_timer context.
+ *          Each wakeup is put off until the window of some job is about to close, and then
+ *          runs every job whose window is open, so jobs that are due close together share it.
+ *
+ * @param[in]  p_job     Job description, copied.
+ * @param[out] p_job_id  Identifier of the job for later calls.
+ *
+ * @retval NRF_ERROR_NO_MEM if SENSOR_SCHEDULER_MAX_JOBS jobs are registered already.
+ */
+ret_code_t sensor_scheduler_register(sensor_scheduler_job_t const * p_job, uint8_t * p_job_id);
+
+/**@brief Function for setting the consumer that paced jobs are scheduled back from.
+ *
+ * @details Each period the fetches that are due run first, then the starts, then the publish
+ *          handler, all in the same wakeup. A paced job is started latency ticks, plus up to
+ *          its jitter, before the publish, so every publish carries a sample taken for it.
+ *
+ * @param[in] publish_handler  Publish handler.
+ * @param[in] period           Ticks between two publishes.
+ */
+ret_code_t sensor_scheduler_publish_set(sensor_scheduler_publish_t publish_handler, uint32_t period);
+
+/**@brief Function for changing the conversion latency of a job, e.g. after a sensor setting changed.
+ *
+ * @details Takes effect from the next start.
+ */
+void sensor_scheduler_latency_set(uint8_t job_id, uint32_t latency);
+
+/**@brief Function for running a job now, outside of its period.
+ *
+ * @details The fetch follows after the latency as for a scheduled start, the period is not shifted.
+ *          Can be called from a handler, e.g. a fetch handler chaining the next conversion.
+ *
+ * @return The result of the start handler.
+ */
+ret_code_t sensor_scheduler_job_run(uint8_t job_id);
+
+/**@brief Function for getting the age of the latest result of a job.
+ *
+ * @return Ticks since the last successful fetch, or the last start of a job without a fetch handler,
+ *         UINT32_MAX if the job has not produced a result yet.
+ */
+uint32_t sensor_scheduler_sample_age_get(uint8_t job_id);
+
+/**@brief Function for starting every registered job and arming the first wakeup.
+ *
+ * @retval NRF_ERROR_INVALID_PARAM if a paced job does not fit in the publish period.
+ */
+ret_code_t sensor_scheduler_start(void);
+
+/**@brief Function for reading the wakeup statistics.
+ *
+ * @details runs / wakeups is the number of jobs sharing a wakeup on average. Wakeups of the
+ *          SoftDevice and of other app_timer users are not counted.
+ */
+void sensor_scheduler_stats_get(sensor_scheduler_stats_t * p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SENSOR_SCHEDULER_H_ */
@@ -1,5 +1,7 @@
 #include <math.h>
 
+#include "app_timer.h"
+
 #include "peripherals.h"
 #include "uv.h"
 
@@ -12,11 +14,12 @@ static float mapfloat(float x, float in_min, float in_max, float out_min, float
 }
 
 
-void uv_init(void)
+uint32_t uv_sample_age_get(void)
 {
-
+    return adc_sample_age_get();
 }
 
+
 void uv_get_data(uint8_t *uv_index)
 {
     float uv_volt_f;
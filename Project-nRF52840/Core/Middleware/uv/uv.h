@@ -7,8 +7,8 @@
 extern "C" {
 #endif
 
-void uv_init(void);
 void uv_get_data(uint8_t *uv_index);
+uint32_t uv_sample_age_get(void);
 
 #ifdef __cplusplus
 }
@@ -5,40 +5,51 @@
 #include "app_timer.h"
 #include "nrf_drv_timer.h"
 #include "nrf_drv_twi.h"
+#include "nrf_twi_mngr.h"
 #include "nrf_drv_spi.h"
-#include "nrf_drv_timer.h"
 #include "nrf_drv_saadc.h"
-#include "nrf_drv_ppi.h"
 
-static uint16_t uvi_adc = 0;
+#include "sensor_scheduler.h"
+
+/**@brief Per channel stage of the SAADC scan. */
+typedef struct
+{
+    nrf_saadc_input_t   input;                  /**< Analog input of the channel. */
+    nrf_saadc_gain_t    gain;                   /**< Input gain, against the 0.6 V internal reference. */
+    uint16_t            full_scale_mv;          /**< Input voltage of a full scale result at that gain. */
+    uint8_t             filter_shift;           /**< Exponential filter weight 1/2^shift of a new result, 0 to not filter. */
+} adc_channel_config_t;
+
+static const adc_channel_config_t m_adc_channels[ADC_CHANNEL_COUNT] =
+{
+    [ADC_CHANNEL_UVI]     = { NRF_SAADC_INPUT_AIN1, NRF_SAADC_GAIN1_6, 3600, 0 },
+    [ADC_CHANNEL_SOIL]    = { NRF_SAADC_INPUT_AIN2, NRF_SAADC_GAIN1_6, 3600, 2 },
+    [ADC_CHANNEL_BATTERY] = { BATTERY_SAADC_INPUT,  NRF_SAADC_GAIN1_2, 1200, 3 },      /**< VDDH/5 is at most 1.1 V. */
+};
+
+static nrf_saadc_value_t            m_adc_buffers[2][ADC_CHANNEL_COUNT];    /**< Interleaved scan results, EasyDMA fills one while the other is read. */
+static uint8_t                      m_adc_buffer_index;                     /**< Buffer the next scan goes to. */
+static nrf_saadc_value_t * volatile m_adc_done_buffer;                      /**< Last completed scan, NULL until the next one completes. */
+static uint32_t                     m_adc_filtered[ADC_CHANNEL_COUNT];      /**< Filter state, in 1/16 counts. */
+static bool                         m_adc_filter_seeded;
+static uint8_t                      m_adc_job_id;
 
-static const nrf_drv_twi_t m_baro_twi       = NRF_DRV_TWI_INSTANCE(BARO_TWI_INSTANCE);
 static const nrf_drv_twi_t m_eep_twi        = NRF_DRV_TWI_INSTANCE(EEP_TWI_INSTANCE);
 static const nrf_drv_spi_t m_env_spi        = NRF_DRV_SPI_INSTANCE(ENV_SPI_INSTANCE);
-static const nrf_drv_timer_t m_gen_timer    = NRF_DRV_TIMER_INSTANCE(GENERAL_TIMER_INSTANACE);
-static nrf_ppi_channel_t     m_ppi_channel;
-
-static nrf_saadc_value_t     m_buffer_pool[2][SAMPLES_IN_BUFFER];
 
-static comm_handle_fptr m_barometer_comm_handler;
-static comm_handle_fptr m_environmental_comm_handler;
 static comm_handle_fptr m_eeprom_comm_handler;
-static comm_handle_fptr m_timer_barometer_handler;
-static comm_handle_fptr m_timer_environmental_handler;
 static comm_handle_fptr m_timer_eeprom_handler;
 static comm_handle_fptr m_timer_ble_update_handler;
-static comm_handle_fptr m_timer_general_handler;
 
 
-APP_TIMER_DEF(m_ble_timer_id);                                                  /**< BLE timer. */
+NRF_TWI_MNGR_DEF(m_baro_twi_mngr, BARO_TWI_MNGR_QUEUE_SIZE, BARO_TWI_INSTANCE); /**< Barometer TWI transaction manager. */
 
 
-static void baro_twi_event_handler(nrf_drv_twi_evt_t const * p_event, void * p_context);
 static void eep_twi_event_handler(nrf_drv_twi_evt_t const * p_event, void * p_context);
 static void env_spi_event_handler(nrf_drv_spi_evt_t const * p_event, void * p_context);
-static void ble_update_timeout_handler(void * p_context);
-static void general_timer_event_handler(nrf_timer_event_t event_type, void* p_context);
-static void timer_ubx_event_handler(nrf_timer_event_t event_type, void* p_context);
+static void ble_update_publish_handler(void);
+static ret_code_t adc_scan_start(void);
+static ret_code_t adc_scan_fetch(void);
 static void saadc_event_handler(nrf_drv_saadc_evt_t const * p_event);
 
 static void gpio_init(void);
@@ -51,6 +62,7 @@ static void timer_init(void);
 
 static void gpio_init(void)
 {
+    nrf_gpio_pin_set(ENV_CS_PIN);
     nrf_gpio_cfg_output(ENV_CS_PIN);
 }
 
@@ -61,57 +73,27 @@ static void pwm_init(void)
 }
 
 
-void saadc_sampling_event_init(void)
-{
-    ret_code_t err_code;
-    int32_t timer_compare_event_addr;
-    uint32_t saadc_sample_task_addr;
-
-    err_code = nrf_drv_ppi_init();
-    APP_ERROR_CHECK(err_code);
-
-    timer_compare_event_addr = nrf_drv_timer_compare_event_address_get(&m_gen_timer, NRF_TIMER_CC_CHANNEL0);
-    saadc_sample_task_addr   = nrf_drv_saadc_sample_task_get();
-
-    /* setup ppi channel so that timer compare event is triggering sample task in SAADC */
-    err_code = nrf_drv_ppi_channel_alloc(&m_ppi_channel);
-    APP_ERROR_CHECK(err_code);
-
-    err_code = nrf_drv_ppi_channel_assign(m_ppi_channel,
-                                          timer_compare_event_addr,
-                                          saadc_sample_task_addr);
-    APP_ERROR_CHECK(err_code);
-
-    err_code = nrf_drv_ppi_channel_enable(m_ppi_channel);
-    APP_ERROR_CHECK(err_code);
-}
-
-
 static void saadc_init(void)
 {
     ret_code_t err_code;
 
-    nrf_saadc_channel_config_t uvi_channel_config = NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(NRF_SAADC_INPUT_AIN1);
-    //nrf_saadc_channel_config_t soil_channel_config = NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(NRF_SAADC_INPUT_AIN2);
-    //nrf_saadc_channel_config_t battery_channel_config = NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(NRF_SAADC_INPUT_AIN3);
-
     err_code = nrf_drv_saadc_init(NULL, saadc_event_handler);
     APP_ERROR_CHECK(err_code);
 
-    err_code = nrf_drv_saadc_channel_init(0, &uvi_channel_config);
-    APP_ERROR_CHECK(err_code);
-
-    //err_code = nrf_drv_saadc_channel_init(1, &soil_channel_config);
-    //APP_ERROR_CHECK(err_code);
-
-    //err_code = nrf_drv_saadc_channel_init(2, &battery_channel_config);
-    //APP_ERROR_CHECK(err_code);
+    /* SAADC_CONFIG_OVERSAMPLE averages in hardware and SAADC_CONFIG_LP_MODE keeps the SAADC, and
+     * the HFCLK it requests, off between scans. With BURST on every channel one trigger converts
+     * all of them, oversampled, into consecutive buffer words. */
+    for (uint8_t channel = 0; channel < ADC_CHANNEL_COUNT; channel++)
+    {
+        nrf_saadc_channel_config_t channel_config =
+            NRF_DRV_SAADC_DEFAULT_CHANNEL_CONFIG_SE(m_adc_channels[channel].input);
 
-    err_code = nrf_drv_saadc_buffer_convert(m_buffer_pool[0], SAMPLES_IN_BUFFER);
-    APP_ERROR_CHECK(err_code);
+        channel_config.gain  = m_adc_channels[channel].gain;
+        channel_config.burst = NRF_SAADC_BURST_ENABLED;
 
-    err_code = nrf_drv_saadc_buffer_convert(m_buffer_pool[1], SAMPLES_IN_BUFFER);
-    APP_ERROR_CHECK(err_code);
+        err_code = nrf_drv_saadc_channel_init(channel, &channel_config);
+        APP_ERROR_CHECK(err_code);
+    }
 }
 
 
@@ -124,14 +106,9 @@ static void twi_init(void)
     baro_twi_config.sda = BARO_I2C_SDA_PIN;
     baro_twi_config.scl = BARO_I2C_SCL_PIN;
 
-#if TWI_USE_INTERRUPT
-    nrf_drv_twi_init(&m_baro_twi, &baro_twi_config, baro_twi_event_handler, NULL);
+    /* The transaction manager owns the TWI instance and runs it in interrupt mode */
+    err_code = nrf_twi_mngr_init(&m_baro_twi_mngr, &baro_twi_config);
     APP_ERROR_CHECK(err_code);
-#else
-    nrf_drv_twi_init(&m_baro_twi, &baro_twi_config, NULL, NULL);
-    APP_ERROR_CHECK(err_code);
-#endif
-    nrf_drv_twi_enable(&m_baro_twi);
 }
 
 
@@ -141,7 +118,8 @@ static void spi_init(void)
 
     nrf_drv_spi_config_t env_spi_config = NRF_DRV_SPI_DEFAULT_CONFIG;
     env_spi_config.frequency  = NRF_DRV_SPI_FREQ_8M;
-    env_spi_config.ss_pin     = ENV_CS_PIN;
+    /* Chip select is driven by env_peripherals_spi_xfer() so that it spans all segments */
+    env_spi_config.ss_pin     = NRF_DRV_SPI_PIN_NOT_USED;
     env_spi_config.mosi_pin   = ENV_MOSI_PIN;
     env_spi_config.miso_pin   = ENV_MISO_PIN;
     env_spi_config.sck_pin    = ENV_SCK_PIN;
@@ -156,29 +134,36 @@ static void spi_init(void)
 }
 
 
+/**@brief Everything runs off the RTC through app_timer, the high frequency clock is only
+ *        requested while a peripheral is busy.
+ */
 static void timer_init(void)
 {
     ret_code_t err_code;
 
-    nrf_drv_timer_config_t timer_cfg = NRF_DRV_TIMER_DEFAULT_CONFIG;
-
     // Initialize timer module.
     err_code = app_timer_init();
     APP_ERROR_CHECK(err_code);
 
-    err_code = app_timer_create(&m_ble_timer_id,
-                                APP_TIMER_MODE_REPEATED,
-                                ble_update_timeout_handler);
+    err_code = sensor_scheduler_init();
     APP_ERROR_CHECK(err_code);
 
-    err_code = nrf_drv_timer_init(&m_gen_timer, &timer_cfg, general_timer_event_handler);
+    /* The BLE update is the consumer the sensor acquisitions are scheduled back from */
+    err_code = sensor_scheduler_publish_set(ble_update_publish_handler, BLE_UPDATE_INTERVAL);
     APP_ERROR_CHECK(err_code);
 
-    nrf_drv_timer_extended_compare(&m_gen_timer,
-                                   NRF_TIMER_CC_CHANNEL0,
-                                   nrf_drv_timer_ms_to_ticks(&m_gen_timer, GENERAL_TIMER_STEP),
-                                   NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK,
-                                   true);
+    /* UV, soil and battery are read by the same SAADC scan */
+    sensor_scheduler_job_t const adc_job =
+    {
+        .start_handler = adc_scan_start,
+        .fetch_handler = adc_scan_fetch,
+        .period        = SENSOR_SCHEDULER_PERIOD_PUBLISH,
+        .latency       = ADC_SCAN_LATENCY,
+        .jitter        = ADC_SCAN_JITTER
+    };
+
+    err_code = sensor_scheduler_register(&adc_job, &m_adc_job_id);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -198,9 +183,6 @@ void peripherals_init(void)
 
     timer_init();
     nrf_delay_ms(10);
-
-    saadc_sampling_event_init();
-    nrf_delay_ms(10);
 }
 
 
@@ -211,32 +193,62 @@ void peripherals_start_timers(void)
     ret_code_t err_code;
 
     // Start application timers.
-    err_code = app_timer_start(m_ble_timer_id, BLE_UPDATE_INTERVAL, NULL);
+    err_code = sensor_scheduler_start();
     APP_ERROR_CHECK(err_code);
-
-    nrf_drv_timer_enable(&m_gen_timer);
 }
 
 
 ret_code_t baro_peripherals_twi_tx(uint16_t device_address, uint8_t *data, uint16_t data_size, bool no_stop)
 {
-    return nrf_drv_twi_tx(&m_baro_twi, device_address, data, data_size, no_stop);
+    nrf_twi_mngr_transfer_t const transfer[] =
+    {
+        NRF_TWI_MNGR_WRITE(device_address, data, data_size, no_stop ? NRF_TWI_MNGR_NO_STOP : 0)
+    };
+
+    return nrf_twi_mngr_perform(&m_baro_twi_mngr, NULL, transfer, ARRAY_SIZE(transfer), NULL);
 }
 
 
 ret_code_t baro_peripherals_twi_rx(uint16_t device_address, uint8_t *data, uint16_t data_size)
 {
-    return nrf_drv_twi_rx(&m_baro_twi, device_address, data, data_size);
+    nrf_twi_mngr_transfer_t const transfer[] =
+    {
+        NRF_TWI_MNGR_READ(device_address, data, data_size, 0)
+    };
+
+    return nrf_twi_mngr_perform(&m_baro_twi_mngr, NULL, transfer, ARRAY_SIZE(transfer), NULL);
 }
 
-ret_code_t env_peripherals_spi_tx(uint8_t *data, uint16_t data_size)
+
+ret_code_t baro_peripherals_twi_schedule(nrf_twi_mngr_transaction_t const * p_transaction)
 {
-    return nrf_drv_spi_transfer(&m_env_spi, data, data_size, NULL, 0);
+    return nrf_twi_mngr_schedule(&m_baro_twi_mngr, p_transaction);
 }
 
-ret_code_t env_peripherals_spi_rx(uint8_t *data, uint16_t data_size)
+/**@brief Run a chip-select framed SPI transaction made of several DMA segments.
+ *
+ * @details Each segment is a separate SPIM transfer straight from/to the caller's buffers, so a
+ *          register burst read is an address segment followed by a receive-only segment of exactly
+ *          the payload length. Buffers must be located in RAM (EasyDMA).
+ */
+ret_code_t env_peripherals_spi_xfer(spi_segment_t const * p_segments, uint8_t segment_count)
 {
-    return nrf_drv_spi_transfer(&m_env_spi, &data[0], 1, &data[1], data_size);
+    ret_code_t err_code = NRF_SUCCESS;
+
+    nrf_gpio_pin_clear(ENV_CS_PIN);
+
+    for (uint8_t segment = 0; (segment < segment_count) && (NRF_SUCCESS == err_code); segment++)
+    {
+        err_code = nrf_drv_spi_transfer(&m_env_spi,
+                                        p_segments[segment].p_tx,
+                                        (NULL != p_segments[segment].p_tx) ? p_segments[segment].length : 0,
+                                        p_segments[segment].p_rx,
+                                        (NULL != p_segments[segment].p_rx) ? p_segments[segment].length : 0);
+    }
+
+    nrf_gpio_pin_set(ENV_CS_PIN);
+
+    return err_code;
 }
 
 
@@ -246,66 +258,144 @@ void peripherals_delay_ms(uint32_t delay_time_ms)
 }
 
 
-void uvi_read_adc(uint16_t *adc)
+/**@brief Trigger one scan of every channel.
+ *
+ * @details Returns right away, the results are written by EasyDMA and collected by
+ *          adc_scan_fetch() ADC_SCAN_LATENCY later.
+ */
+static ret_code_t adc_scan_start(void)
 {
-    *adc = uvi_adc;
-}
+    ret_code_t err_code;
 
+    err_code = nrf_drv_saadc_buffer_convert(m_adc_buffers[m_adc_buffer_index], ADC_CHANNEL_COUNT);
+    if (NRF_SUCCESS != err_code)
+    {
+        return err_code;
+    }
 
-void uvi_read_voltage(float *volt)
-{
-    *volt = ((float)(uvi_adc) * 3.3) / ((float)(4096.0));
+    m_adc_buffer_index ^= 1;
+
+    return nrf_drv_saadc_sample();
 }
 
 
-void saadc_event_handler(nrf_drv_saadc_evt_t const * p_event)
+/**@brief De-interleave the last completed scan into the per channel filters.
+ *
+ * @details Runs in the sensor scheduler, out of the SAADC interrupt. A scan still converting is
+ *          reported as NRF_ERROR_BUSY, the filters and the sample age keep the previous scan.
+ */
+static ret_code_t adc_scan_fetch(void)
 {
-    ret_code_t err_code;
+    nrf_saadc_value_t * p_buffer = m_adc_done_buffer;
+    uint32_t            result;
+
+    if (NULL == p_buffer)
+    {
+        return NRF_ERROR_BUSY;
+    }
 
-    uint32_t adc_sum = 0;
+    m_adc_done_buffer = NULL;
 
-    if (p_event->type == NRF_DRV_SAADC_EVT_DONE)
+    for (uint8_t channel = 0; channel < ADC_CHANNEL_COUNT; channel++)
     {
-        err_code = nrf_drv_saadc_buffer_convert(p_event->data.done.p_buffer, SAMPLES_IN_BUFFER);
-        APP_ERROR_CHECK(err_code);
-        
-        for (uint8_t adc_sample_count = 0; adc_sample_count < SAMPLES_IN_BUFFER; adc_sample_count++)
+        result = (uint32_t)MAX(p_buffer[channel], 0) << 4;
+
+        if (!m_adc_filter_seeded || (0 == m_adc_channels[channel].filter_shift))
         {
-            adc_sum += p_event->data.done.p_buffer[adc_sample_count];
+            m_adc_filtered[channel] = result;
         }
+        else
+        {
+            uint8_t shift = m_adc_channels[channel].filter_shift;
 
-        uvi_adc = adc_sum / SAMPLES_IN_BUFFER;
+            m_adc_filtered[channel] += (result >> shift) - (m_adc_filtered[channel] >> shift);
+        }
     }
+
+    m_adc_filter_seeded = true;
+
+    return NRF_SUCCESS;
 }
 
 
-/**@brief Function for handling the Battery measurement timer timeout.
- *
- * @details This function will be called each time the battery level measurement timer expires.
- *
- * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
- *                       app_start_timer() call to the timeout handler.
- */
-static void ble_update_timeout_handler(void * p_context)
+static uint16_t adc_channel_get(adc_channel_t channel)
 {
-    UNUSED_PARAMETER(p_context);
-    if (NULL != m_timer_ble_update_handler)
+    return (uint16_t)((m_adc_filtered[channel] + 8) >> 4);
+}
+
+
+static uint16_t adc_channel_mv_get(adc_channel_t channel)
+{
+    return (uint16_t)(((m_adc_filtered[channel] * m_adc_channels[channel].full_scale_mv) / ADC_RESOLUTION_COUNTS + 8) >> 4);
+}
+
+
+uint32_t adc_sample_age_get(void)
+{
+    return sensor_scheduler_sample_age_get(m_adc_job_id);
+}
+
+
+void uvi_read_adc(uint16_t *adc)
+{
+    *adc = adc_channel_get(ADC_CHANNEL_UVI);
+}
+
+
+void uvi_read_voltage(float *volt)
+{
+    *volt = ((float)(adc_channel_get(ADC_CHANNEL_UVI)) * 3.3) / ((float)(4096.0));
+}
+
+
+void soil_read_adc(uint16_t *adc)
+{
+    *adc = adc_channel_get(ADC_CHANNEL_SOIL);
+}
+
+
+/**@brief The probe voltage falls linearly from SOIL_DRY_MV to SOIL_WET_MV as moisture rises. */
+void soil_read_moisture(uint8_t *percent)
+{
+    uint16_t soil_mv = adc_channel_mv_get(ADC_CHANNEL_SOIL);
+
+    soil_mv = MIN(MAX(soil_mv, SOIL_WET_MV), SOIL_DRY_MV);
+
+    *percent = (uint8_t)(((uint32_t)(SOIL_DRY_MV - soil_mv) * 100) / (SOIL_DRY_MV - SOIL_WET_MV));
+}
+
+
+void battery_read_adc(uint16_t *adc)
+{
+    *adc = adc_channel_get(ADC_CHANNEL_BATTERY);
+}
+
+
+void battery_read_voltage(uint16_t *millivolts)
+{
+    *millivolts = adc_channel_mv_get(ADC_CHANNEL_BATTERY) * BATTERY_INPUT_SCALE;
+}
+
+
+void saadc_event_handler(nrf_drv_saadc_evt_t const * p_event)
+{
+    if (NRF_DRV_SAADC_EVT_DONE == p_event->type)
     {
-        m_timer_ble_update_handler();
+        m_adc_done_buffer = p_event->data.done.p_buffer;
     }
 }
 
 
-void baro_twi_event_handler(nrf_drv_twi_evt_t const * p_event, void * p_context)
+/**@brief Function for handling the Battery measurement publish.
+ *
+ * @details This function will be called by the sensor scheduler every BLE_UPDATE_INTERVAL,
+ *          right after the sensor results for it came in.
+ */
+static void ble_update_publish_handler(void)
 {
-    switch (p_event->type)
+    if (NULL != m_timer_ble_update_handler)
     {
-        case NRF_DRV_TWI_EVT_DONE:
-        {
-            break;
-        }
-
-        default: break;
+        m_timer_ble_update_handler();
     }
 }
 
@@ -330,77 +420,18 @@ static void env_spi_event_handler(nrf_drv_spi_evt_t const * p_event, void * p_co
 }
 
 
-/**
- * @brief Handler for timer events.
- */
-static void general_timer_event_handler(nrf_timer_event_t event_type, void* p_context)
-{
-    switch (event_type)
-    {
-        case NRF_TIMER_EVENT_COMPARE0:
-        {
-            if (NULL != m_timer_general_handler)
-            {
-                m_timer_general_handler();
-            }
-
-            if (NULL != m_timer_barometer_handler)
-            {
-                m_timer_barometer_handler();
-            }
-
-            if (NULL != m_timer_environmental_handler)
-            {
-                m_timer_environmental_handler();
-            }
-            break;
-        }
-
-        default:
-        {
-            //Do nothing.
-            break;
-        }
-    }
-}
-
-
 void peripherals_assign_comm_handle(uint8_t comm_handle_type, comm_handle_fptr comm_handle)
 {
     if (NULL != comm_handle)
     {
         switch (comm_handle_type)
         {
-            case BAROMETER_COMM:
-            {
-                m_barometer_comm_handler = comm_handle;           
-                break;
-            }
-
-            case ENVIRONMENTAL_COMM:
-            {
-                m_environmental_comm_handler = comm_handle; 
-                break;
-            }
-
             case EEP_COMM:
             {
                 m_eeprom_comm_handler = comm_handle; 
                 break;
             }
 
-            case TIMER_BAROMETER:
-            {
-                m_timer_barometer_handler = comm_handle;
-                break;
-            }
-
-            case TIMER_ENVIRONMENTAL:
-            {
-                m_timer_environmental_handler = comm_handle;
-                break;
-            }
-
             case TIMER_EEP:
             {
                 m_timer_eeprom_handler = comm_handle;
@@ -413,27 +444,7 @@ void peripherals_assign_comm_handle(uint8_t comm_handle_type, comm_handle_fptr c
                 break;
             }
 
-            case TIMER_GENERAL:
-            {
-                m_timer_general_handler = comm_handle;
-                break;
-            }
-
             default: break;
         }
     }
 }
-
-
-void comm_handle_polling(void)
-{
-    if (NULL != m_barometer_comm_handler)
-    {
-        m_barometer_comm_handler();
-    }
-
-    if (NULL != m_environmental_comm_handler)
-    {
-        m_environmental_comm_handler();
-    }
-}
\ No newline at end of file
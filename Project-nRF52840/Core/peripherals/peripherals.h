@@ -13,6 +13,7 @@ extern "C" {
 #include "nrf_assert.h"
 #include "nrf_error.h"
 #include "boards.h"
+#include "nrf_twi_mngr.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
@@ -25,7 +26,8 @@ extern "C" {
 
 #define ENV_SPI_INSTANCE                2
 
-#define GENERAL_TIMER_INSTANACE         1
+#define BARO_TWI_MNGR_QUEUE_SIZE        4
+
 #define SENSOR_TIMER_INSTANCE           2
 
 #define BARO_I2C_SDA_PIN                ARDUINO_A4_PIN
@@ -49,25 +51,45 @@ extern "C" {
 
 #define BLE_UPDATE_INTERVAL             APP_TIMER_TICKS(5000)                       /**< Battery level measurement interval (ticks). */
 
-#define GENERAL_TIMER_STEP                    (100)   /* ms */
-#define BAROMETER_TWI_PROCESS_DATA_PERIOD     (500)  /* GENERAL_TIMER_STEP */
-#define ENVIRONMENTAL_TWI_PROCESS_DATA_PERIOD (500)  /* GENERAL_TIMER_STEP */
+/* Every sensor is acquired once per BLE update, timed back from it by its conversion time.
+ * The jitter is how much earlier the acquisition may start to share a wakeup. */
+#define BAROMETER_SAMPLE_JITTER         APP_TIMER_TICKS(250)                        /**< Lets the ICP101xx command go out with the BME680 trigger. */
+#define ENVIRONMENTAL_SAMPLE_JITTER     APP_TIMER_TICKS(10)
+#define ADC_SCAN_JITTER                 APP_TIMER_TICKS(250)                        /**< Lets the SAADC trigger share the wakeup of the other starts. */
+#define ADC_SCAN_LATENCY                APP_TIMER_TICKS(10)                         /**< 256 oversamples of each channel, 12 us each. */
+
+#define ADC_RESOLUTION_COUNTS           4096
+#define SOIL_DRY_MV                     2500                                        /**< Capacitive probe output in dry air. */
+#define SOIL_WET_MV                     1100                                        /**< Capacitive probe output in water. */
+
+/* The cell is measured on the supply pin it powers, VDDH/5 in high voltage mode, or VDD */
+#define BATTERY_SAADC_INPUT             NRF_SAADC_INPUT_VDDHDIV5
+#define BATTERY_INPUT_SCALE             5
 
 #define BAROMETER_TRIGGER_PERIOD        3
 
-#define BAROMETER_COMM                  (1)
-#define ENVIRONMENTAL_COMM              (BAROMETER_COMM + 1)
-#define EEP_COMM                        (ENVIRONMENTAL_COMM + 1)
-#define TIMER_BAROMETER                 (EEP_COMM + 1)
-#define TIMER_ENVIRONMENTAL             (TIMER_BAROMETER + 1)
-#define TIMER_EEP                       (TIMER_ENVIRONMENTAL + 1)
+#define EEP_COMM                        (1)
+#define TIMER_EEP                       (EEP_COMM + 1)
 #define TIMER_BLE_UPDATE                (TIMER_EEP + 1)
-#define TIMER_GENERAL                   (TIMER_BLE_UPDATE + 1)
-
-#define SAMPLES_IN_BUFFER               24
 
 typedef void (*comm_handle_fptr)(void);
 
+/**@brief Channels converted by one SAADC scan, in the order the results are interleaved. */
+typedef enum
+{
+    ADC_CHANNEL_UVI,
+    ADC_CHANNEL_SOIL,
+    ADC_CHANNEL_BATTERY,
+    ADC_CHANNEL_COUNT
+} adc_channel_t;
+
+typedef struct
+{
+    uint8_t const * p_tx;       /**< Data to send, NULL to clock out the over-read character only. */
+    uint8_t       * p_rx;       /**< Buffer for received data, NULL to discard what is clocked in. */
+    uint8_t         length;     /**< Number of bytes in this segment, at most 255 as nrf_drv_spi takes. A BME680 field burst (0x1D-0x2E) fits in one. */
+} spi_segment_t;
+
 void peripherals_init(void);
 void peripherals_start_timers(void);
 
@@ -75,19 +97,25 @@ void peripherals_assign_comm_handle(uint8_t comm_handle_type, comm_handle_fptr c
 
 ret_code_t baro_peripherals_twi_tx(uint16_t device_address, uint8_t *data, uint16_t data_size, bool no_stop);
 ret_code_t baro_peripherals_twi_rx(uint16_t device_address, uint8_t *data, uint16_t data_size);
+ret_code_t baro_peripherals_twi_schedule(nrf_twi_mngr_transaction_t const * p_transaction);
 
 ret_code_t eep_peripherals_twi_tx(uint16_t device_address, uint8_t *data, uint16_t data_size, bool no_stop);
 ret_code_t env_peripherals_twi_rx(uint16_t device_address, uint8_t *data, uint16_t data_size);
 
-ret_code_t env_peripherals_spi_tx(uint8_t *data, uint16_t data_size);
-ret_code_t env_peripherals_spi_rx(uint8_t *data, uint16_t data_size);
+ret_code_t env_peripherals_spi_xfer(spi_segment_t const * p_segments, uint8_t segment_count);
+
+uint32_t adc_sample_age_get(void);
 
 void uvi_read_adc(uint16_t *adc);
 void uvi_read_voltage(float *volt);
 
-void peripherals_delay_ms(uint32_t delay_time_ms);
+void soil_read_adc(uint16_t *adc);
+void soil_read_moisture(uint8_t *percent);
 
-void comm_handle_polling(void);
+void battery_read_adc(uint16_t *adc);
+void battery_read_voltage(uint16_t *millivolts);
+
+void peripherals_delay_ms(uint32_t delay_time_ms);
 
 
 #ifdef __cplusplus
@@ -444,7 +444,7 @@
 
 
 #ifndef BLE_RACP_ENABLED
-#define BLE_RACP_ENABLED 0
+#define BLE_RACP_ENABLED 1
 #endif
 
 // <e> NRF_BLE_CONN_PARAMS_ENABLED - ble_conn_params - Initiating and executing a connection parameters negotiation procedure
@@ -842,6 +842,152 @@
 #define BLE_ECS_ENABLED 0
 #endif
 
+// <h> BLE_ESS_CONFIG - ble_ess - Environmental Sensing Service characteristics
+
+//==========================================================
+// <q> BLE_ESS_CONFIG_AWD_ENABLED  - Apparent Wind Direction
+
+
+#ifndef BLE_ESS_CONFIG_AWD_ENABLED
+#define BLE_ESS_CONFIG_AWD_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_AWS_ENABLED  - Apparent Wind Speed
+
+
+#ifndef BLE_ESS_CONFIG_AWS_ENABLED
+#define BLE_ESS_CONFIG_AWS_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_DP_ENABLED  - Dew Point
+
+
+#ifndef BLE_ESS_CONFIG_DP_ENABLED
+#define BLE_ESS_CONFIG_DP_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_EL_ENABLED  - Elevation
+
+
+#ifndef BLE_ESS_CONFIG_EL_ENABLED
+#define BLE_ESS_CONFIG_EL_ENABLED 1
+#endif
+
+// <q> BLE_ESS_CONFIG_GF_ENABLED  - Gust Factor
+
+
+#ifndef BLE_ESS_CONFIG_GF_ENABLED
+#define BLE_ESS_CONFIG_GF_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_HI_ENABLED  - Heat Index
+
+
+#ifndef BLE_ESS_CONFIG_HI_ENABLED
+#define BLE_ESS_CONFIG_HI_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_HUM_ENABLED  - Humidity
+
+
+#ifndef BLE_ESS_CONFIG_HUM_ENABLED
+#define BLE_ESS_CONFIG_HUM_ENABLED 1
+#endif
+
+// <q> BLE_ESS_CONFIG_IRD_ENABLED  - Irradiance
+
+
+#ifndef BLE_ESS_CONFIG_IRD_ENABLED
+#define BLE_ESS_CONFIG_IRD_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_PC_ENABLED  - Pollen Concentration
+
+
+#ifndef BLE_ESS_CONFIG_PC_ENABLED
+#define BLE_ESS_CONFIG_PC_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_RF_ENABLED  - Rainfall
+
+
+#ifndef BLE_ESS_CONFIG_RF_ENABLED
+#define BLE_ESS_CONFIG_RF_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_PS_ENABLED  - Pressure
+
+
+#ifndef BLE_ESS_CONFIG_PS_ENABLED
+#define BLE_ESS_CONFIG_PS_ENABLED 1
+#endif
+
+// <q> BLE_ESS_CONFIG_TEM_ENABLED  - Temperature
+
+
+#ifndef BLE_ESS_CONFIG_TEM_ENABLED
+#define BLE_ESS_CONFIG_TEM_ENABLED 1
+#endif
+
+// <q> BLE_ESS_CONFIG_TWD_ENABLED  - True Wind Direction
+
+
+#ifndef BLE_ESS_CONFIG_TWD_ENABLED
+#define BLE_ESS_CONFIG_TWD_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_TWS_ENABLED  - True Wind Speed
+
+
+#ifndef BLE_ESS_CONFIG_TWS_ENABLED
+#define BLE_ESS_CONFIG_TWS_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_UVI_ENABLED  - UV Index
+
+
+#ifndef BLE_ESS_CONFIG_UVI_ENABLED
+#define BLE_ESS_CONFIG_UVI_ENABLED 1
+#endif
+
+// <q> BLE_ESS_CONFIG_WC_ENABLED  - Wind Chill
+
+
+#ifndef BLE_ESS_CONFIG_WC_ENABLED
+#define BLE_ESS_CONFIG_WC_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_BPT_ENABLED  - Barometric Pressure Trend
+
+
+#ifndef BLE_ESS_CONFIG_BPT_ENABLED
+#define BLE_ESS_CONFIG_BPT_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_MD_ENABLED  - Magnetic Declination
+
+
+#ifndef BLE_ESS_CONFIG_MD_ENABLED
+#define BLE_ESS_CONFIG_MD_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_MFD2D_ENABLED  - Magnetic Flux Density - 2D
+
+
+#ifndef BLE_ESS_CONFIG_MFD2D_ENABLED
+#define BLE_ESS_CONFIG_MFD2D_ENABLED 0
+#endif
+
+// <q> BLE_ESS_CONFIG_MFD3D_ENABLED  - Magnetic Flux Density - 3D
+
+
+#ifndef BLE_ESS_CONFIG_MFD3D_ENABLED
+#define BLE_ESS_CONFIG_MFD3D_ENABLED 0
+#endif
+
+// </h>
+//==========================================================
+
 // <q> BLE_GLS_ENABLED  - ble_gls - Glucose Service
 
 
@@ -4575,7 +4721,7 @@
 
 
 #ifndef NRFX_TIMER1_ENABLED
-#define NRFX_TIMER1_ENABLED 1
+#define NRFX_TIMER1_ENABLED 0
 #endif
 
 // <q> NRFX_TIMER2_ENABLED  - Enable TIMER2 instance
@@ -6125,14 +6271,14 @@
 // <8=> 256x
 
 #ifndef SAADC_CONFIG_OVERSAMPLE
-#define SAADC_CONFIG_OVERSAMPLE 0
+#define SAADC_CONFIG_OVERSAMPLE 8
 #endif
 
 // <q> SAADC_CONFIG_LP_MODE  - Enabling low power mode
 
 
 #ifndef SAADC_CONFIG_LP_MODE
-#define SAADC_CONFIG_LP_MODE 0
+#define SAADC_CONFIG_LP_MODE 1
 #endif
 
 // <o> SAADC_CONFIG_IRQ_PRIORITY  - Interrupt priority
@@ -6414,7 +6560,7 @@
 
 
 #ifndef TIMER1_ENABLED
-#define TIMER1_ENABLED 1
+#define TIMER1_ENABLED 0
 #endif
 
 // <q> TIMER2_ENABLED  - Enable TIMER2 instance
@@ -6581,7 +6727,7 @@
 
 
 #ifndef TWI0_USE_EASY_DMA
-#define TWI0_USE_EASY_DMA 0
+#define TWI0_USE_EASY_DMA 1
 #endif
 
 // </e>
@@ -7400,7 +7546,7 @@
 // <i> The total amount of flash memory that is used by FDS amounts to @ref FDS_VIRTUAL_PAGES * @ref FDS_VIRTUAL_PAGE_SIZE * 4 bytes.
 
 #ifndef FDS_VIRTUAL_PAGES
-#define FDS_VIRTUAL_PAGES 3
+#define FDS_VIRTUAL_PAGES 9
 #endif
 
 // <o> FDS_VIRTUAL_PAGE_SIZE  - The size of a virtual flash page.
@@ -8192,7 +8338,7 @@
 
 
 #ifndef NRF_TWI_MNGR_ENABLED
-#define NRF_TWI_MNGR_ENABLED 0
+#define NRF_TWI_MNGR_ENABLED 1
 #endif
 
 // <q> RETARGET_ENABLED  - retarget - Retargeting stdio functions
@@ -12537,7 +12683,7 @@
 // <i> Requested BLE GAP data length to be negotiated.
 
 #ifndef NRF_SDH_BLE_GAP_DATA_LENGTH
-#define NRF_SDH_BLE_GAP_DATA_LENGTH 27
+#define NRF_SDH_BLE_GAP_DATA_LENGTH 251
 #endif
 
 // <o> NRF_SDH_BLE_PERIPHERAL_LINK_COUNT - Maximum number of peripheral links.
@@ -12561,17 +12707,17 @@
 // <i> The time set aside for this connection on every connection interval in 1.25 ms units.
 
 #ifndef NRF_SDH_BLE_GAP_EVENT_LENGTH
-#define NRF_SDH_BLE_GAP_EVENT_LENGTH 6
+#define NRF_SDH_BLE_GAP_EVENT_LENGTH 12
 #endif
 
 // <o> NRF_SDH_BLE_GATT_MAX_MTU_SIZE - Static maximum MTU size.
 #ifndef NRF_SDH_BLE_GATT_MAX_MTU_SIZE
-#define NRF_SDH_BLE_GATT_MAX_MTU_SIZE 49
+#define NRF_SDH_BLE_GATT_MAX_MTU_SIZE 247
 #endif
 
 // <o> NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE - Attribute Table size in bytes. The size must be a multiple of 4.
 #ifndef NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE
-#define NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE 2560
+#define NRF_SDH_BLE_GATTS_ATTR_TAB_SIZE 1792
 #endif
 
 // <o> NRF_SDH_BLE_VS_UUID_COUNT - The number of vendor-specific UUIDs.
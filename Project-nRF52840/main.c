@@ -64,8 +64,9 @@
 #include "ble_dis.h"
 #include "ble_bas.h"
 #include "ble_ess.h"
+#include "ble_els.h"
+#include "ble_aqs.h"
 #include "ble_conn_params.h"
-#include "sensorsim.h"
 #include "nrf_sdh.h"
 #include "nrf_sdh_soc.h"
 #include "nrf_sdh_ble.h"
@@ -83,7 +84,12 @@
 
 #include "peripherals.h"
 #include "environmental.h"
+#include "barometer.h"
+#include "iaq.h"
 #include "uv.h"
+#include "battery.h"
+#include "datalog.h"
+#include "sensor_scheduler.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
@@ -97,18 +103,26 @@
 
 #define APP_BLE_OBSERVER_PRIO           3                                           /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 #define APP_BLE_CONN_CFG_TAG            1                                           /**< A tag identifying the SoftDevice BLE configuration. */
+#define APP_HVN_TX_QUEUE_SIZE           (BLE_ESS_SNAPSHOT_COUNT + 2)                /**< Notification queue depth per link: one ESS snapshot plus the battery level and the air quality. */
+
+#define ESS_ELEVATION_DEADBAND          100                                         /**< Elevation change that is not notified (1 m, in 0.01 m). */
+#define ESS_HUMIDITY_DEADBAND           50                                          /**< Humidity change that is not notified (0.5 %, in 0.01 %). */
+#define ESS_PRESSURE_DEADBAND           100                                         /**< Pressure change that is not notified (10 Pa, in 0.1 Pa). */
+#define ESS_TEMPERATURE_DEADBAND        10                                          /**< Temperature change that is not notified (0.1 degree Celsius, in 0.01 degree). */
+#define ESS_UV_INDEX_DEADBAND           0                                           /**< Every UV Index change is notified. */
+
+#define DATALOG_SAMPLE_PERIOD           12                                          /**< BLE updates between logged samples (1 minute). */
 
 #define APP_ADV_INTERVAL                40                                          /**< The advertising interval (in units of 0.625 ms. This value corresponds to 25 ms). */
 #define APP_ADV_DURATION                18000                                       /**< The advertising duration (180 seconds) in units of 10 milliseconds. */
 
-#define MIN_BATTERY_LEVEL               81                                          /**< Minimum battery level as returned by the simulated measurement function. */
-#define MAX_BATTERY_LEVEL               100                                         /**< Maximum battery level as returned by the simulated measurement function. */
-#define BATTERY_LEVEL_INCREMENT         1                                           /**< Value by which the battery level is incremented/decremented for each call to the simulated measurement function. */
 
 #define MIN_CONN_INTERVAL               MSEC_TO_UNITS(10, UNIT_1_25_MS)             /**< Minimum acceptable connection interval (10 ms). */
 #define MAX_CONN_INTERVAL               MSEC_TO_UNITS(100, UNIT_1_25_MS)            /**< Maximum acceptable connection interval (100 ms) */
 #define SLAVE_LATENCY                   0                                           /**< Slave latency. */
 #define CONN_SUP_TIMEOUT                MSEC_TO_UNITS(4000, UNIT_10_MS)             /**< Connection supervisory timeout (4 seconds). */
+#define BULK_MIN_CONN_INTERVAL          MSEC_TO_UNITS(7.5, UNIT_1_25_MS)            /**< Minimum connection interval while the log is downloaded (7.5 ms). */
+#define BULK_MAX_CONN_INTERVAL          MSEC_TO_UNITS(15, UNIT_1_25_MS)             /**< Maximum connection interval while the log is downloaded (15 ms). */
 #define FIRST_CONN_PARAMS_UPDATE_DELAY  APP_TIMER_TICKS(5000)                       /**< Time from initiating event (connect or start of notification) to first time sd_ble_gap_conn_param_update is called (5 seconds). */
 #define NEXT_CONN_PARAMS_UPDATE_DELAY   APP_TIMER_TICKS(30000)                      /**< Time between each call to sd_ble_gap_conn_param_update after the first call (30 seconds). */
 #define MAX_CONN_PARAM_UPDATE_COUNT     3                                           /**< Number of attempts before giving up the connection parameter negotiation. */
@@ -133,26 +147,33 @@
 
 #define DEAD_BEEF                       0xDEADBEEF                                  /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 
-BLE_ESS_DEF(m_ess);                                                                 /**< Structure used to identify the environmental sensing service. */
+BLE_ESS_DEF(m_ess, NRF_SDH_BLE_TOTAL_LINK_COUNT);                                   /**< Structure used to identify the environmental sensing service. */
+BLE_ELS_DEF(m_els);                                                                 /**< Structure used to identify the environmental log service. */
+BLE_AQS_DEF(m_aqs, NRF_SDH_BLE_TOTAL_LINK_COUNT);                                   /**< Structure used to identify the air quality service. */
 BLE_BAS_DEF(m_bas);                                                                 /**< Structure used to identify the battery service. */
 NRF_BLE_GATT_DEF(m_gatt);                                                           /**< GATT module instance. */
-NRF_BLE_QWR_DEF(m_qwr);                                                             /**< Context for the Queued Write module.*/
+NRF_BLE_QWRS_DEF(m_qwr, NRF_SDH_BLE_TOTAL_LINK_COUNT);                              /**< Context for the Queued Write module, one per link.*/
 BLE_ADVERTISING_DEF(m_advertising);                                                 /**< Advertising module instance. */
 
 
 static pm_peer_id_t m_peer_to_be_deleted = PM_PEER_ID_INVALID;
 static uint8_t      m_alert_message_buffer[MESSAGE_BUFFER_SIZE];                    /**< Message buffer for optional notify messages. */
-static uint16_t     m_conn_handle        = BLE_CONN_HANDLE_INVALID;                 /**< Handle of the current connection. */
+static uint16_t     m_conn_handle        = BLE_CONN_HANDLE_INVALID;                 /**< Handle of the most recent connection. */
 static ble_uuid_t   m_adv_uuids[] =                                                 /**< Universally unique service identifiers. */
 {
     {BLE_UUID_ENVIRONMENTAL_SENSING_SERVICE, BLE_UUID_TYPE_BLE},
     {BLE_UUID_BATTERY_SERVICE, BLE_UUID_TYPE_BLE},
     {BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_TYPE_BLE}
 };
-static sensorsim_cfg_t   m_battery_sim_cfg;                                         /**< Battery Level sensor simulator configuration. */
-static sensorsim_state_t m_battery_sim_state;                                       /**< Battery Level sensor simulator state. */
+static const battery_curve_point_t m_battery_curve[] =                              /**< Open circuit discharge curve of a single Li-ion cell. */
+{
+    {4200, 100}, {4100, 91}, {4000, 80}, {3900, 68}, {3800, 54},
+    {3700, 36},  {3600, 17}, {3500, 7},  {3400, 2},  {3300, 0}
+};
+
 static env_data_t        m_app_env_data;
 static uint8_t           m_uv_index;
+static uint8_t           m_datalog_countdown;
 
 
 static void advertising_start(bool erase_bonds);
@@ -207,9 +228,9 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
             {
                 // The peer did not use MITM, disconnect.
                 NRF_LOG_INFO("Collector did not use MITM, disconnecting");
-                err_code = pm_peer_id_get(m_conn_handle, &m_peer_to_be_deleted);
+                err_code = pm_peer_id_get(p_evt->conn_handle, &m_peer_to_be_deleted);
                 APP_ERROR_CHECK(err_code);
-                err_code = sd_ble_gap_disconnect(m_conn_handle,
+                err_code = sd_ble_gap_disconnect(p_evt->conn_handle,
                                                  BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
                 APP_ERROR_CHECK(err_code);
             }
@@ -235,6 +256,31 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
 }
 
 
+/**@brief Function for copying the power counters of the sensors to the Diagnostics characteristic.
+ */
+static void diagnostics_update(void)
+{
+    ret_code_t               err_code;
+    sensor_scheduler_stats_t scheduler_stats;
+    env_gas_stats_t          gas_stats;
+    ble_els_diagnostics_t    diagnostics;
+
+    sensor_scheduler_stats_get(&scheduler_stats);
+    environmental_gas_stats_get(&gas_stats);
+
+    diagnostics.wakeups           = scheduler_stats.wakeups;
+    diagnostics.runs              = scheduler_stats.runs;
+    diagnostics.wakeups_last_hour = scheduler_stats.wakeups_last_hour;
+    diagnostics.runs_last_hour    = scheduler_stats.runs_last_hour;
+    diagnostics.heated_cycles     = gas_stats.heated_cycles;
+    diagnostics.skipped_cycles    = gas_stats.skipped_cycles;
+    diagnostics.heater_saved_ms   = gas_stats.heater_saved_ms;
+
+    err_code = ble_els_diagnostics_update(&m_els, &diagnostics);
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for performing battery measurement and updating the Battery Level characteristic
  *        in Battery Service.
  */
@@ -242,67 +288,106 @@ static void ble_update(void)
 {
     ret_code_t err_code;
     uint8_t battery_level;
+    ble_ess_snapshot_t ess_snapshot;
+    barometer_sample_t baro_sample;
+    iaq_result_t iaq_result;
 
-    battery_level = (uint8_t)sensorsim_measure(&m_battery_sim_state, &m_battery_sim_cfg);
     environmental_get_data(&m_app_env_data);
     uv_get_data(&m_uv_index);
 
-    err_code = ble_bas_battery_level_update(&m_bas, battery_level, BLE_CONN_HANDLE_ALL);
-    if ((err_code != NRF_SUCCESS) &&
-        (err_code != NRF_ERROR_INVALID_STATE) &&
-        (err_code != NRF_ERROR_RESOURCES) &&
-        (err_code != NRF_ERROR_BUSY) &&
-        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
-       )
+    // The gauge only reports a level when the integer percentage moved.
+    if (battery_level_update(&battery_level))
     {
-        APP_ERROR_HANDLER(err_code);
+        err_code = ble_bas_battery_level_update(&m_bas, battery_level, BLE_CONN_HANDLE_ALL);
+        if ((err_code != NRF_SUCCESS) &&
+            (err_code != NRF_ERROR_INVALID_STATE) &&
+            (err_code != NRF_ERROR_RESOURCES) &&
+            (err_code != NRF_ERROR_BUSY) &&
+            (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
+           )
+        {
+            APP_ERROR_HANDLER(err_code);
+        }
     }
 
-    err_code = ble_ess_elevation_update(&m_ess, m_app_env_data.altitude);
-    if ((err_code != NRF_SUCCESS) &&
-        (err_code != NRF_ERROR_INVALID_STATE) &&
-        (err_code != NRF_ERROR_RESOURCES) &&
-        (err_code != NRF_ERROR_BUSY) &&
-        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
-       )
+    // Only changed values are notified, the index moves with the gas scans, far less often than this.
+    if (iaq_result_get(&iaq_result))
     {
-        APP_ERROR_HANDLER(err_code);
+        ble_aqs_iaq_t const iaq =
+        {
+            .iaq      = iaq_result.iaq,
+            .eco2     = iaq_result.eco2,
+            .bvoc     = iaq_result.bvoc,
+            .accuracy = iaq_result.accuracy
+        };
+
+        err_code = ble_aqs_iaq_update(&m_aqs, &iaq, BLE_CONN_HANDLE_ALL);
+        if ((err_code != NRF_SUCCESS) &&
+            (err_code != NRF_ERROR_INVALID_STATE) &&
+            (err_code != NRF_ERROR_RESOURCES) &&
+            (err_code != NRF_ERROR_BUSY) &&
+            (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
+           )
+        {
+            APP_ERROR_HANDLER(err_code);
+        }
     }
 
-    err_code = ble_ess_humidity_update(&m_ess, m_app_env_data.humidity / 10);
-    if ((err_code != NRF_SUCCESS) &&
-        (err_code != NRF_ERROR_INVALID_STATE) &&
-        (err_code != NRF_ERROR_RESOURCES) &&
-        (err_code != NRF_ERROR_BUSY) &&
-        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
-       )
+    // A sensor that missed its acquisition keeps its last value out of the snapshot.
+    ess_snapshot.fields = 0;
+    if (environmental_sample_age_get() <= BLE_UPDATE_INTERVAL)
     {
-        APP_ERROR_HANDLER(err_code);
+        ess_snapshot.fields |= BLE_ESS_SNAPSHOT_EL | BLE_ESS_SNAPSHOT_HUM | BLE_ESS_SNAPSHOT_PS |
+                               BLE_ESS_SNAPSHOT_TEM;
     }
-
-    err_code = ble_ess_pressure_update(&m_ess, m_app_env_data.pressure);
-    if ((err_code != NRF_SUCCESS) &&
-        (err_code != NRF_ERROR_INVALID_STATE) &&
-        (err_code != NRF_ERROR_RESOURCES) &&
-        (err_code != NRF_ERROR_BUSY) &&
-        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
-       )
+    if (uv_sample_age_get() <= BLE_UPDATE_INTERVAL)
     {
-        APP_ERROR_HANDLER(err_code);
+        ess_snapshot.fields |= BLE_ESS_SNAPSHOT_UVI;
+    }
+    // The BME680 reads 0.001 % and Pa, ESS carries 0.01 % and 0.1 Pa.
+    ess_snapshot.elevation   = m_app_env_data.altitude;
+    ess_snapshot.humidity    = m_app_env_data.humidity / 10;
+    ess_snapshot.pressure    = m_app_env_data.pressure * 10;
+    ess_snapshot.temperature = m_app_env_data.temperature;
+    ess_snapshot.uv_index    = m_uv_index;
+
+    // The ICP101xx holds +-1 Pa of relative accuracy against +-12 Pa for the BME680, so it takes
+    // over elevation and pressure whenever its conversion for this publish came in.
+    if ((barometer_sample_age_get() <= BLE_UPDATE_INTERVAL) && barometer_data_get(&baro_sample))
+    {
+        ess_snapshot.fields   |= BLE_ESS_SNAPSHOT_EL | BLE_ESS_SNAPSHOT_PS;
+        ess_snapshot.elevation = (int32_t)(baro_sample.altitude * 100.0f);
+        ess_snapshot.pressure  = (uint32_t)(baro_sample.pressure * 1000.0f + 0.5f);
     }
 
-    err_code = ble_ess_temperature_update(&m_ess, m_app_env_data.temperature);
-    if ((err_code != NRF_SUCCESS) &&
-        (err_code != NRF_ERROR_INVALID_STATE) &&
-        (err_code != NRF_ERROR_RESOURCES) &&
-        (err_code != NRF_ERROR_BUSY) &&
-        (err_code != BLE_ERROR_GATTS_SYS_ATTR_MISSING)
-       )
+    // Samples are logged whether or not a collector is connected, and fetched later through the RACP.
+    if (m_datalog_countdown == 0)
     {
-        APP_ERROR_HANDLER(err_code);
+        datalog_sample_t sample;
+
+        m_datalog_countdown = DATALOG_SAMPLE_PERIOD;
+
+        sample.temperature = ess_snapshot.temperature;
+        sample.humidity    = ess_snapshot.humidity;
+        sample.pressure    = ess_snapshot.pressure;
+        sample.elevation   = ess_snapshot.elevation;
+        sample.uv_index    = ess_snapshot.uv_index;
+
+        err_code = datalog_append(&sample);
+        if ((err_code != NRF_SUCCESS) &&
+            (err_code != NRF_ERROR_INVALID_STATE) &&
+            (err_code != NRF_ERROR_BUSY))
+        {
+            APP_ERROR_HANDLER(err_code);
+        }
     }
+    m_datalog_countdown--;
 
-    err_code = ble_ess_uv_index_update(&m_ess, m_uv_index);
+    // Read on demand only, the attribute table is kept current.
+    diagnostics_update();
+
+    // Changed values are queued back to back on every subscribed link; the rest follow on BLE_GATTS_EVT_HVN_TX_COMPLETE.
+    err_code = ble_ess_snapshot_publish(&m_ess, &ess_snapshot, BLE_CONN_HANDLE_ALL, NULL);
     if ((err_code != NRF_SUCCESS) &&
         (err_code != NRF_ERROR_INVALID_STATE) &&
         (err_code != NRF_ERROR_RESOURCES) &&
@@ -315,12 +400,6 @@ static void ble_update(void)
 }
 
 
-static void general_timer_handler(void)
-{
-
-}
-
-
 /**@brief Function for the GAP initialization.
  *
  * @details This function sets up all the necessary GAP (Generic Access Profile) parameters of the
@@ -386,6 +465,78 @@ static void alert_notification_error_handler(uint32_t nrf_error)
 }
 
 
+/**@brief Function for switching a link between the low duty and the bulk sync profile.
+ *
+ * @details The bulk profile asks for a short connection interval and the 2 Mbps PHY, so a log
+ *          download finishes in a few seconds with every connection event filled. Afterwards the
+ *          link goes back to the preferred connection parameters and lets the peer pick the PHY.
+ *          The Connection Parameters module keeps negotiating towards whichever profile was set.
+ *
+ * @param[in]   conn_handle  Link to switch.
+ * @param[in]   bulk         true for the bulk sync profile, false for the low duty profile.
+ */
+static void link_profile_set(uint16_t conn_handle, bool bulk)
+{
+    ret_code_t            err_code;
+    ble_gap_conn_params_t conn_params;
+    ble_gap_phys_t const  phys =
+    {
+        .rx_phys = bulk ? BLE_GAP_PHY_2MBPS : BLE_GAP_PHY_AUTO,
+        .tx_phys = bulk ? BLE_GAP_PHY_2MBPS : BLE_GAP_PHY_AUTO,
+    };
+
+    conn_params.min_conn_interval = bulk ? BULK_MIN_CONN_INTERVAL : MIN_CONN_INTERVAL;
+    conn_params.max_conn_interval = bulk ? BULK_MAX_CONN_INTERVAL : MAX_CONN_INTERVAL;
+    conn_params.slave_latency     = SLAVE_LATENCY;
+    conn_params.conn_sup_timeout  = CONN_SUP_TIMEOUT;
+
+    // The link may be gone or busy with another procedure, the profile then stays as it is.
+    err_code = ble_conn_params_change_conn_params(conn_handle, &conn_params);
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_INVALID_STATE) &&
+        (err_code != NRF_ERROR_BUSY) &&
+        (err_code != BLE_ERROR_INVALID_CONN_HANDLE))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+
+    err_code = sd_ble_gap_phy_update(conn_handle, &phys);
+    if ((err_code != NRF_SUCCESS) &&
+        (err_code != NRF_ERROR_INVALID_STATE) &&
+        (err_code != NRF_ERROR_BUSY) &&
+        (err_code != BLE_ERROR_INVALID_CONN_HANDLE))
+    {
+        APP_ERROR_HANDLER(err_code);
+    }
+}
+
+
+/**@brief Function for handling the Environmental Log Service events.
+ *
+ * @param[in]   p_els   Environmental Log Service structure.
+ * @param[in]   p_evt   Event received from the Environmental Log Service.
+ */
+static void on_els_evt(ble_els_t * p_els, ble_els_evt_t * p_evt)
+{
+    switch (p_evt->evt_type)
+    {
+        case BLE_ELS_EVT_TRANSFER_STARTED:
+            NRF_LOG_INFO("Log download started, bulk sync profile.");
+            link_profile_set(p_evt->conn_handle, true);
+            break;
+
+        case BLE_ELS_EVT_TRANSFER_FINISHED:
+            NRF_LOG_INFO("Log download finished, low duty profile.");
+            link_profile_set(p_evt->conn_handle, false);
+            break;
+
+        default:
+            // No implementation needed.
+            break;
+    }
+}
+
+
 /**@brief Function for initializing services that will be used by the application.
  *
  * @details Initialize the Glucose, Battery and Device Information services.
@@ -394,6 +545,8 @@ static void services_init(void)
 {
     ret_code_t         err_code;
     ble_ess_init_t     ess_init;
+    ble_els_init_t     els_init;
+    ble_aqs_init_t     aqs_init;
     ble_bas_init_t     bas_init;
     ble_dis_init_t     dis_init;
     nrf_ble_qwr_init_t qwr_init = {0};
@@ -401,32 +554,64 @@ static void services_init(void)
     // Initialize Queued Write Module.
     qwr_init.error_handler = nrf_qwr_error_handler;
 
-    err_code = nrf_ble_qwr_init(&m_qwr, &qwr_init);
-    APP_ERROR_CHECK(err_code);
+    for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++)
+    {
+        err_code = nrf_ble_qwr_init(&m_qwr[i], &qwr_init);
+        APP_ERROR_CHECK(err_code);
+    }
 
     // Initialize Environmental Sensing Service.
     memset(&ess_init, 0, sizeof(ess_init));
     
-    ess_init.el_rd_sec          = SEC_OPEN;
-    ess_init.el_cccd_wr_sec     = SEC_OPEN;
-    ess_init.hum_cccd_wr_sec    = SEC_OPEN;
-    ess_init.hum_rd_sec         = SEC_OPEN;
-    ess_init.ps_cccd_wr_sec     = SEC_OPEN;
-    ess_init.ps_rd_sec          = SEC_OPEN;
-    ess_init.tem_cccd_wr_sec    = SEC_OPEN;
-    ess_init.tem_rd_sec         = SEC_OPEN;
-    ess_init.uvi_cccd_wr_sec    = SEC_OPEN;
-    ess_init.uvi_rd_sec         = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_EL].rd_sec       = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_EL].cccd_wr_sec  = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_HUM].rd_sec      = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_HUM].cccd_wr_sec = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_PS].rd_sec       = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_PS].cccd_wr_sec  = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_TEM].rd_sec      = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_TEM].cccd_wr_sec = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_UVI].rd_sec      = SEC_OPEN;
+    ess_init.chars[BLE_ESS_CHAR_UVI].cccd_wr_sec = SEC_OPEN;
     
-    ess_init.support_el_notification  = true;
-    ess_init.support_hum_notification = true;
-    ess_init.support_ps_notification  = true;
-    ess_init.support_tem_notification = true;
-    ess_init.support_uvi_notification = true;
+    ess_init.chars[BLE_ESS_CHAR_EL].notification  = true;
+    ess_init.chars[BLE_ESS_CHAR_HUM].notification = true;
+    ess_init.chars[BLE_ESS_CHAR_PS].notification  = true;
+    ess_init.chars[BLE_ESS_CHAR_TEM].notification = true;
+    ess_init.chars[BLE_ESS_CHAR_UVI].notification = true;
+
+    // Changes inside these deadbands are not notified until a client sets another trigger.
+    ess_init.chars[BLE_ESS_CHAR_EL].deadband  = ESS_ELEVATION_DEADBAND;
+    ess_init.chars[BLE_ESS_CHAR_HUM].deadband = ESS_HUMIDITY_DEADBAND;
+    ess_init.chars[BLE_ESS_CHAR_PS].deadband  = ESS_PRESSURE_DEADBAND;
+    ess_init.chars[BLE_ESS_CHAR_TEM].deadband = ESS_TEMPERATURE_DEADBAND;
+    ess_init.chars[BLE_ESS_CHAR_UVI].deadband = ESS_UV_INDEX_DEADBAND;
 
     err_code = ble_ess_init(&m_ess, &ess_init);
     APP_ERROR_CHECK(err_code);
 
+    // Initialize Environmental Log Service.
+    memset(&els_init, 0, sizeof(els_init));
+
+    els_init.evt_handler        = on_els_evt;
+    els_init.p_gatt             = &m_gatt;
+    els_init.record_cccd_wr_sec = SEC_OPEN;
+    els_init.racp_cccd_wr_sec   = SEC_OPEN;
+    els_init.racp_wr_sec        = SEC_OPEN;
+    els_init.diagnostics_rd_sec = SEC_OPEN;
+
+    err_code = ble_els_init(&m_els, &els_init);
+    APP_ERROR_CHECK(err_code);
+
+    // Initialize Air Quality Service.
+    memset(&aqs_init, 0, sizeof(aqs_init));
+
+    aqs_init.iaq_rd_sec      = SEC_OPEN;
+    aqs_init.iaq_cccd_wr_sec = SEC_OPEN;
+
+    err_code = ble_aqs_init(&m_aqs, &aqs_init);
+    APP_ERROR_CHECK(err_code);
+
     // Initialize Battery Service.
     memset(&bas_init, 0, sizeof(bas_init));
 
@@ -462,16 +647,18 @@ static void services_init(void)
 }
 
 
-/**@brief Function for initializing the sensor simulators.
+/**@brief Function for initializing the battery gauge.
  */
-static void sensor_simulator_init(void)
+static void battery_gauge_init(void)
 {
-    m_battery_sim_cfg.min          = MIN_BATTERY_LEVEL;
-    m_battery_sim_cfg.max          = MAX_BATTERY_LEVEL;
-    m_battery_sim_cfg.incr         = BATTERY_LEVEL_INCREMENT;
-    m_battery_sim_cfg.start_at_max = true;
+    ret_code_t     err_code;
+    battery_init_t battery_init_obj;
 
-    sensorsim_init(&m_battery_sim_state, &m_battery_sim_cfg);
+    battery_init_obj.p_curve      = m_battery_curve;
+    battery_init_obj.curve_points = ARRAY_SIZE(m_battery_curve);
+
+    err_code = battery_init(&battery_init_obj);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -584,7 +771,11 @@ static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 
         case BLE_ADV_EVT_IDLE:
         {
-            sleep_mode_enter();
+            // Only sleep once the last collector is gone.
+            if (ble_conn_state_peripheral_conn_count() == 0)
+            {
+                sleep_mode_enter();
+            }
             break; // BLE_ADV_EVT_IDLE
         }
 
@@ -610,7 +801,16 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
         case BLE_GAP_EVT_DISCONNECTED:
         {
             NRF_LOG_INFO("Disconnected");
-            m_conn_handle = BLE_CONN_HANDLE_INVALID;
+            if (p_ble_evt->evt.gap_evt.conn_handle == m_conn_handle)
+            {
+                // The advertising module restarts advertising for the most recent link itself.
+                m_conn_handle = BLE_CONN_HANDLE_INVALID;
+            }
+            else if (ble_conn_state_peripheral_conn_count() == NRF_SDH_BLE_PERIPHERAL_LINK_COUNT - 1)
+            {
+                // A slot was freed while all links were in use, advertise for it again.
+                advertising_start(false);
+            }
             // Check if the last connected peer had not used MITM, if so, delete its bond information.
             if (m_peer_to_be_deleted != PM_PEER_ID_INVALID)
             {
@@ -629,8 +829,14 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
             err_code = bsp_indication_set(BSP_INDICATE_CONNECTED);
             APP_ERROR_CHECK(err_code);
             m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
-            err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr, m_conn_handle);
+            err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr[ble_conn_state_conn_idx(m_conn_handle)],
+                                                      m_conn_handle);
             APP_ERROR_CHECK(err_code);
+            // Keep advertising while there is room for more collectors.
+            if (ble_conn_state_peripheral_conn_count() < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
+            {
+                advertising_start(false);
+            }
             // Start Security Request timer.
             break;
         }
@@ -731,10 +937,25 @@ static void ble_stack_init(void)
     err_code = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ram_start);
     APP_ERROR_CHECK(err_code);
 
+    // Deepen the notification queue so a full sensor snapshot fits in one connection event.
+    ble_cfg_t ble_cfg;
+    memset(&ble_cfg, 0, sizeof(ble_cfg));
+    ble_cfg.conn_cfg.conn_cfg_tag                            = APP_BLE_CONN_CFG_TAG;
+    ble_cfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size = APP_HVN_TX_QUEUE_SIZE;
+    err_code = sd_ble_cfg_set(BLE_CONN_CFG_GATTS, &ble_cfg, ram_start);
+    APP_ERROR_CHECK(err_code);
+
     // Enable BLE stack.
     err_code = nrf_sdh_ble_enable(&ram_start);
     APP_ERROR_CHECK(err_code);
 
+    // Let connection events run past NRF_SDH_BLE_GAP_EVENT_LENGTH while there is data to send.
+    ble_opt_t ble_opt;
+    memset(&ble_opt, 0, sizeof(ble_opt));
+    ble_opt.common_opt.conn_evt_ext.enable = 1;
+    err_code = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &ble_opt);
+    APP_ERROR_CHECK(err_code);
+
     // Register a handler for BLE events.
     NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
 }
@@ -964,7 +1185,9 @@ static void advertising_start(bool erase_bonds)
  */
 int main(void)
 {
-    bool erase_bonds;
+    ret_code_t err_code;
+    bool       erase_bonds;
+    fds_stat_t fds_stat_info;
 
     // Initialize.
     log_init();
@@ -977,14 +1200,24 @@ int main(void)
     gatt_init();
     advertising_init();
     services_init();
-    sensor_simulator_init();
+    battery_gauge_init();
     conn_params_init();
     peer_manager_init();
 
+    err_code = datalog_init();
+    APP_ERROR_CHECK(err_code);
+
+    // The barometer calibration cache is read from flash, fds completes its initialization on a SoC event.
+    while (fds_stat(&fds_stat_info) == FDS_ERR_NOT_INITIALIZED)
+    {
+        idle_state_handle();
+    }
+
+    // Both sensors register their scheduler jobs before the timers start.
     environmental_init();
+    barometer_init();
 
     peripherals_assign_comm_handle(TIMER_BLE_UPDATE, ble_update);
-    peripherals_assign_comm_handle(TIMER_GENERAL, general_timer_handler);
 
     // Start execution.
     NRF_LOG_INFO("Positioning example started.");
@@ -994,7 +1227,6 @@ int main(void)
     // Enter main loop.
     for (;;)
     {
-        comm_handle_polling();
         idle_state_handle();
     }
 }
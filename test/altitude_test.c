@@ -0,0 +1,114 @@
+/* altitude_get() against the hypsometric formula with libm pow() in double precision: worst
+ * error over the polynomial range and the powf() fallback, then the host time per call next to
+ * the libm float and double versions. The host timing only compares the three on this machine,
+ * it says nothing about Cortex-M4F cycles.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "altitude.h"
+
+#define POLY_LIMIT_M            0.016       /* Stated in altitude.h for pressure ratios 0.5 to 1.25 */
+#define FALLBACK_LIMIT_M        0.05        /* powf() rounding at the far ends */
+#define TIMING_POINTS           1024
+#define TIMING_ROUNDS           20000
+
+static volatile float m_sink;
+
+
+static double reference_altitude(double pressure, double temperature, double qnh)
+{
+    return (1.0 - pow(pressure / qnh, 0.19022)) * ((temperature + 273.15) / 0.0065);
+}
+
+
+static float libm_float_altitude(float pressure, float temperature)
+{
+    return (1.0f - powf(pressure / ALTITUDE_QNH_DEFAULT, 0.19022f)) * ((temperature + 273.15f) / 0.0065f);
+}
+
+
+static float libm_double_altitude(float pressure, float temperature)
+{
+    return (float)reference_altitude(pressure, temperature, ALTITUDE_QNH_DEFAULT);
+}
+
+
+/* Worst error over a pressure range, the polynomial covers about 507 to 1267 hPa at the default QNH */
+static double error_max(double pressure_low, double pressure_high, double temperature)
+{
+    double worst = 0.0;
+
+    for (double pressure = pressure_low; pressure <= pressure_high; pressure += 0.01)
+    {
+        double error = fabs(altitude_get((float)pressure, (float)temperature) -
+                            reference_altitude((float)pressure, (float)temperature, ALTITUDE_QNH_DEFAULT));
+
+        worst = fmax(worst, error);
+    }
+
+    return worst;
+}
+
+
+static double time_ns(float (*p_altitude)(float, float), float const *p_pressure)
+{
+    struct timespec start;
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int round = 0; round < TIMING_ROUNDS; round++)
+    {
+        for (int i = 0; i < TIMING_POINTS; i++)
+        {
+            m_sink = p_altitude(p_pressure[i], 20.0f);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / ((double)TIMING_ROUNDS * TIMING_POINTS);
+}
+
+
+int main(void)
+{
+    float  pressure[TIMING_POINTS];
+    double poly_error = 0.0;
+    double fallback_error = 0.0;
+    int    failed;
+
+    for (int temperature = -20; temperature <= 50; temperature += 10)
+    {
+        poly_error     = fmax(poly_error, error_max(507.0, 1267.0, temperature));
+        fallback_error = fmax(fallback_error, error_max(300.0, 506.99, temperature));
+    }
+
+    printf("Error against libm, -20 to 50 degC: %.4f m from 507 to 1267 hPa, %.4f m from 300 to 507 hPa\n",
+           poly_error, fallback_error);
+
+    /* QNH changes the ratio only, the polynomial range moves along */
+    altitude_qnh_set(1030.0f);
+    if (fabs(altitude_get(1030.0f, 15.0f)) > POLY_LIMIT_M)
+    {
+        printf("FAIL: altitude at QNH is %f m\n", altitude_get(1030.0f, 15.0f));
+        return EXIT_FAILURE;
+    }
+    altitude_qnh_set(ALTITUDE_QNH_DEFAULT);
+
+    for (int i = 0; i < TIMING_POINTS; i++)
+    {
+        pressure[i] = 700.0f + 400.0f * i / TIMING_POINTS;
+    }
+
+    printf("Host time per call: altitude_get %.1f ns, powf %.1f ns, pow %.1f ns\n",
+           time_ns(altitude_get, pressure), time_ns(libm_float_altitude, pressure), time_ns(libm_double_altitude, pressure));
+
+    failed = (poly_error > POLY_LIMIT_M) || (fallback_error > FALLBACK_LIMIT_M);
+
+    printf(failed ? "FAIL\n" : "PASS\n");
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
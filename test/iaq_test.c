@@ -0,0 +1,152 @@
+/* iaq_update() driven from power up through every accuracy state, the index mapping checked over
+ * every ratio, and the host time per update. iaq.c is included so the static mapping can be
+ * called directly.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "iaq.c"
+
+#define CLEAN_RESISTANCE        100000      /* Ohm */
+#define POLLUTED_RESISTANCE     40000       /* Ratio 0.4, under the 0.5 HIGH needs */
+#define REFERENCE_HUMIDITY      40000       /* 0.001 %RH */
+#define TIMING_UPDATES          10000000
+
+static volatile uint16_t m_sink;
+static int               m_failures;
+
+
+static void check(int condition, char const * p_what)
+{
+    if (!condition)
+    {
+        printf("FAIL: %s\n", p_what);
+        m_failures++;
+    }
+}
+
+
+static void mapping_test(void)
+{
+    uint16_t previous = IAQ_MAX;
+
+    for (uint32_t ratio = 0; ratio <= UINT16_MAX; ratio++)
+    {
+        uint16_t iaq = ratio_to_iaq((uint16_t)ratio);
+
+        if ((iaq > IAQ_MAX) || (iaq > previous))
+        {
+            printf("FAIL: ratio %u maps to %u after %u\n", ratio, iaq, previous);
+            m_failures++;
+            return;
+        }
+
+        previous = iaq;
+    }
+
+    check(ratio_to_iaq(IAQ_RATIO_ONE) == IAQ_CLEAN, "the baseline maps to IAQ_CLEAN");
+    check(ratio_to_iaq(IAQ_RATIO_WORST) == IAQ_MAX, "the worst ratio maps to IAQ_MAX");
+    check(ratio_to_iaq(IAQ_RATIO_BEST) == 0, "the best ratio maps to 0");
+}
+
+
+/* Feed count readings, the accuracy must never go back */
+static iaq_result_t feed(uint32_t count, uint32_t gas_resistance, uint32_t humidity, uint8_t * p_accuracy)
+{
+    iaq_result_t result = { 0 };
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        iaq_update(gas_resistance, humidity, &result);
+
+        if (result.accuracy < *p_accuracy)
+        {
+            printf("FAIL: accuracy fell from %u to %u\n", *p_accuracy, result.accuracy);
+            m_failures++;
+        }
+        *p_accuracy = result.accuracy;
+
+        check(result.iaq <= IAQ_MAX, "index within IAQ_MAX");
+        check(result.eco2 == IAQ_ECO2_CLEAN + result.iaq * IAQ_ECO2_PER_INDEX, "eCO2 follows the index");
+        check(result.bvoc == result.iaq * IAQ_BVOC_PER_INDEX, "bVOC follows the index");
+    }
+
+    return result;
+}
+
+
+static void state_test(void)
+{
+    iaq_result_t result;
+    uint8_t      accuracy = IAQ_ACCURACY_STABILIZING;
+
+    iaq_reset();
+    check(!iaq_result_get(&result), "no result before the first reading");
+
+    result = feed(IAQ_STABILIZE_UPDATES, CLEAN_RESISTANCE, REFERENCE_HUMIDITY, &accuracy);
+    check(result.accuracy == IAQ_ACCURACY_STABILIZING, "stabilizing while the sensor settles");
+    check(iaq_result_get(&result), "a result after the first reading");
+
+    result = feed(1, CLEAN_RESISTANCE, REFERENCE_HUMIDITY, &accuracy);
+    check(result.accuracy == IAQ_ACCURACY_LOW, "low while the baseline is young");
+    check(result.iaq == IAQ_CLEAN, "clean air at the baseline");
+
+    result = feed(IAQ_SETTLED_UPDATES - IAQ_STABILIZE_UPDATES, CLEAN_RESISTANCE, REFERENCE_HUMIDITY, &accuracy);
+    check(result.accuracy == IAQ_ACCURACY_MEDIUM, "medium once the baseline settled");
+
+    /* Humid clean air reads lower, the compensation keeps it near the baseline */
+    result = feed(1, CLEAN_RESISTANCE * 100 / 130, REFERENCE_HUMIDITY + 20000, &accuracy);
+    check(result.iaq <= IAQ_CLEAN + 10, "humid clean air stays clean");
+
+    result = feed(1, POLLUTED_RESISTANCE, REFERENCE_HUMIDITY, &accuracy);
+    check(result.accuracy == IAQ_ACCURACY_HIGH, "high after a 2:1 excursion");
+    check(result.iaq > 300, "polluted air scores high");
+
+    /* The baseline follows the dirtier air slowly, the index comes back down */
+    result = feed(2000, POLLUTED_RESISTANCE, REFERENCE_HUMIDITY, &accuracy);
+    check(result.iaq < 200, "a lasting level becomes the new baseline");
+
+    /* Extremes must not overflow */
+    result = feed(1, UINT32_MAX, 100000, &accuracy);
+    check(result.iaq == 0, "a very clean reading scores 0");
+    result = feed(1, 1, 0, &accuracy);
+    check(result.iaq == IAQ_MAX, "a shorted sensor scores IAQ_MAX");
+
+    printf("Accuracy went through stabilizing, low, medium and high\n");
+}
+
+
+static void timing_test(void)
+{
+    struct timespec start;
+    struct timespec end;
+    iaq_result_t    result;
+    double          ns;
+
+    iaq_reset();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (uint32_t i = 0; i < TIMING_UPDATES; i++)
+    {
+        /* Resistance and humidity sweep so every branch of the baseline runs */
+        iaq_update(20000 + (i * 7919) % 200000, 20000 + (i * 104729) % 60000, &result);
+        m_sink = result.iaq;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / TIMING_UPDATES;
+    printf("Host time per update: %.1f ns\n", ns);
+}
+
+
+int main(void)
+{
+    mapping_test();
+    state_test();
+    timing_test();
+
+    printf(m_failures ? "FAIL\n" : "PASS\n");
+    return m_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
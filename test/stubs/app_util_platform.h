@@ -0,0 +1,11 @@
+/* Host stand-in for the nRF5 SDK header, the tests run single threaded. */
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+#define MIN(a, b)               ((a) < (b) ? (a) : (b))
+#define MAX(a, b)               ((a) < (b) ? (b) : (a))
+
+#define CRITICAL_REGION_ENTER()
+#define CRITICAL_REGION_EXIT()
+
+#endif /* APP_UTIL_PLATFORM_H__ */